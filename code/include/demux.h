@@ -19,19 +19,214 @@
 
 #pragma once
 #include <iterator>
+#include <vector>
+#include <memory>
+#include <cassert>
+#include <initializer_list>
 
 #include "detail/utils.h"
 #include "detail/iterators.h"
 #include "detail/chaineable.h"
 
 namespace func{
+
+    /*
+     * a collection of up to N values kept inline, no heap involved. Meant for the results of
+     * demux functors which produce a handful of values per element: the slots are default
+     * constructed and copied as a whole, with a fixed trip count the compiler can unroll.
+     */
+    template <typename T, std::size_t N>
+    struct static_vector{
+
+        using value_type = T;
+        using iterator = T*;
+        using const_iterator = const T*;
+
+        T values[N];
+        std::size_t count;
+
+        static_vector() : values(), count(0) {}
+
+        static_vector(std::initializer_list<T> l) : values(), count(0) {
+            assert(l.size() <= N && "static_vector capacity exceeded");
+            for (const auto& x : l) values[count++] = x;
+        }
+
+        void push_back(const T& v){
+            assert(count < N && "static_vector capacity exceeded");
+            values[count++] = v;
+        }
+
+        void push_back(T&& v){
+            assert(count < N && "static_vector capacity exceeded");
+            values[count++] = std::move(v);
+        }
+
+        void clear(){ count = 0; }
+
+        std::size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        static constexpr std::size_t capacity() { return N; }
+
+        T& operator[](std::size_t i){ return values[i]; }
+        const T& operator[](std::size_t i) const { return values[i]; }
+
+        T* data(){ return values; }
+        const T* data() const { return values; }
+
+        iterator begin(){ return values; }
+        iterator end(){ return values + count; }
+        const_iterator begin() const { return values; }
+        const_iterator end() const { return values + count; }
+    };
+
+    /*
+     * what the functors of demux_emit call to produce each value: emit(v).
+     * The values are appended to a buffer which is reused for every element of the source,
+     * A is the allocator of that buffer
+     */
+    template <typename T, typename A = std::allocator<T>>
+    struct emitter{
+        std::vector<T, A>& buffer;
+
+        explicit emitter(std::vector<T, A>& buffer) : buffer(buffer) {}
+
+        void operator()(const T& v){ buffer.push_back(v); }
+        void operator()(T&& v){ buffer.push_back(std::move(v)); }
+    };
+
+namespace detail{
+
+    // a demux functor which emits its values, f(x, emit), instead of returning a collection
+    template <typename F, typename T, typename A = std::allocator<T>>
+    struct emitting{
+        F f;
+        emitting(F f) : f(f) {}
+    };
+
+    // the results of an element replace the previous ones
+    template <typename F, typename X, typename R>
+    void demux_fill(F& f, X&& x, R& res){
+        res = f(std::forward<X>(x));
+    }
+
+    // emitted ones go to the same buffer, its capacity is kept from element to element
+    template <typename F, typename T, typename A, typename X>
+    void demux_fill(emitting<F, T, A>& f, X&& x, std::vector<T, A>& res){
+        res.clear();
+        emitter<T, A> emit(res);
+        f.f(std::forward<X>(x), emit);
+    }
+
+    // the results of an element are appended to out, buffer is only used by emitting functors
+    // which emit to a buffer of another allocator
+    template <typename F, typename X, typename R, typename T>
+    void demux_append(F& f, X&& x, R&, std::vector<T>& out){
+        auto r = f(std::forward<X>(x));
+        out.insert(out.end(), std::make_move_iterator(r.begin()), std::make_move_iterator(r.end()));
+    }
+
+    template <typename F, typename T, typename X>
+    void demux_append(emitting<F, T>& f, X&& x, std::vector<T>&, std::vector<T>& out){
+        emitter<T> emit(out);
+        f.f(std::forward<X>(x), emit);
+    }
+
+    template <typename F, typename T, typename A, typename X>
+    void demux_append(emitting<F, T, A>& f, X&& x, std::vector<T, A>& buffer, std::vector<T>& out){
+        demux_fill(f, std::forward<X>(x), buffer);
+        out.insert(out.end(), std::make_move_iterator(buffer.begin()), std::make_move_iterator(buffer.end()));
+    }
+
+    // the results of an element are handed to k, buffer is only used by emitting functors.
+    // Returned collections are temporaries, inline ones can live in registers
+    template <typename F, typename X, typename R, typename K>
+    void demux_each(F& f, X&& x, R&, K& k){
+        for (auto&& v : f(std::forward<X>(x))) k(v);
+    }
+
+    template <typename F, typename T, typename A, typename X, typename K>
+    void demux_each(emitting<F, T, A>& f, X&& x, std::vector<T, A>& buffer, K& k){
+        demux_fill(f, std::forward<X>(x), buffer);
+        for (auto& v : buffer) k(v);
+    }
+
+    /*
+     * where a demux iterator keeps the results of the current element: shared by the copies
+     * of the iterator, so they are O(1) and the local iterators stay valid in all of them.
+     * The results are only refilled in place when no other iterator looks at them, otherwise
+     * they are set aside as a spare: once the other iterator is gone (as the one returned by
+     * it++) the next refill takes it back with its capacity.
+     */
+    template <typename C>
+    struct demux_results{
+        std::shared_ptr<C> ptr;
+        std::shared_ptr<C> spare;
+
+        demux_results() = default;
+        demux_results(demux_results&&) = default;
+        demux_results& operator= (demux_results&&) = default;
+
+        // the spare is private to each iterator
+        demux_results(const demux_results& o) : ptr(o.ptr) {}
+        demux_results& operator= (const demux_results& o){
+            ptr = o.ptr;
+            return *this;
+        }
+
+        // local iterators before the first fetch
+        typename C::iterator none() { return typename C::iterator(); }
+
+        C& refill(){
+            if (ptr && ptr.use_count() == 1) return *ptr;
+            if (spare && spare.use_count() == 1) std::swap(ptr, spare);
+            else{
+                spare = std::move(ptr);
+                ptr = std::make_shared<C>();
+            }
+            return *ptr;
+        }
+
+        // the position in this store of an iterator into the store o
+        template <typename It>
+        It rebase(const demux_results&, It it) const { return it; }
+    };
+
+    // inline results travel with the iterator, the positions are moved into the copy
+    template <typename T, std::size_t N>
+    struct demux_results<static_vector<T, N>>{
+        static_vector<T, N> values;
+
+        T* none() { return values.begin(); }
+
+        static_vector<T, N>& refill(){
+            return values;
+        }
+
+        T* rebase(const demux_results& o, const T* it) {
+            return values.begin() + (it - o.values.begin());
+        }
+    };
+
+    template <typename R, std::size_t N>
+    struct is_static_vector : std::false_type { };
+
+    template <typename T, std::size_t N>
+    struct is_static_vector<static_vector<T, N>, N> : std::true_type { };
+}
+
 namespace it{
     namespace {
         template <typename F, typename Param>
         struct get_ret_type{
             static Param* dummy;
             static F dummyF;
-            using type = decltype(dummyF(*dummy));
+            using type = decltype(dummyF(**dummy));
+        };
+
+        template <typename F, typename T, typename A, typename Param>
+        struct get_ret_type<detail::emitting<F, T, A>, Param>{
+            using type = std::vector<T, A>;
         };
 
         template <typename A, typename B>
@@ -53,51 +248,45 @@ namespace it{
         using local_it = typename local_collection::iterator;
 
         validate<typename local_collection::value_type, Value> _a;
-        validate<typename local_it::value_type, Value> _b;
+        validate<typename std::iterator_traits<local_it>::value_type, Value> _b;
 
-        local_collection last_result;
+        detail::demux_results<local_collection> last_result;
         local_it local_s, local_e;
 
         using source_type = Source;
         using self_type = DemuxIterator<Value, Source, Func>;
 
         DemuxIterator(Func& f, const Source& s, const Source& e)
-        :f(f), s(s), e(e){
-            if (s!=e){
-                last_result = this->f(*s);
-                this->s++;
-            }
-            local_s = last_result.begin();
-            local_e = last_result.end();
+        :f(f), s(s), e(e), local_s(last_result.none()), local_e(last_result.none()){
+            fetch();
             if (s==e) assert(local_e == local_s);
-            if (s==e) assert(local_e - local_s == 0);
-            if (s==e) assert(last_result.empty());
         }
 
         DemuxIterator(const DemuxIterator& o)
-        : f(o.f), s(o.s), e(o.e),
-          last_result(o.last_result), local_e(o.local_e), local_s(o.local_s)
-        {}
+        : f(o.f), s(o.s), e(o.e), last_result(o.last_result),
+          local_s(last_result.rebase(o.last_result, o.local_s)), local_e(last_result.rebase(o.last_result, o.local_e))
+        { }
 
         DemuxIterator(DemuxIterator&& o)
-        : f(o.f), s(std::move(o.s)), e(std::move(o.e)),
-          last_result(std::move(o.last_result)),
-          local_e(std::move(o.local_e)), local_s(std::move(o.local_s))
-        {}
+        : f(o.f), s(std::move(o.s)), e(std::move(o.e)), last_result(std::move(o.last_result)),
+          local_s(last_result.rebase(o.last_result, o.local_s)), local_e(last_result.rebase(o.last_result, o.local_e))
+        { }
 
         DemuxIterator& operator= (const DemuxIterator& o){
             s = o.s;
+            e = o.e;
             last_result = o.last_result;
-            local_s = o.local_s;
-            local_e = o.local_e;
+            local_s = last_result.rebase(o.last_result, o.local_s);
+            local_e = last_result.rebase(o.last_result, o.local_e);
             return *this;
         }
 
         DemuxIterator& operator= (DemuxIterator&& o){
-            std::swap(s, o.s);
-            std::swap(last_result, o.last_result);
-            std::swap(local_s, o.local_s);
-            std::swap(local_e, o.local_e);
+            s = std::move(o.s);
+            e = std::move(o.e);
+            last_result = std::move(o.last_result);
+            local_s = last_result.rebase(o.last_result, o.local_s);
+            local_e = last_result.rebase(o.last_result, o.local_e);
             return *this;
         }
 
@@ -120,20 +309,40 @@ namespace it{
             return &(*(local_s));
         }
 
+        // the pending results are copied in runs, until the block is full or the source exhausted
+        std::size_t next_block(Value* out, std::size_t n, const self_type&){
+            std::size_t k = 0;
+            while (k < n && local_s != local_e){
+                for (; k < n && local_s != local_e; ++k, ++local_s){
+                    out[k] = *local_s;
+                }
+                fetch();
+            }
+            return k;
+        }
+
         void plusplus(){
             if (local_e != local_s){
                 local_s++;
             }
-            if (local_s == local_e && s != e){
-                assert(s != e);
-                static_assert(std::is_same<decltype(last_result), decltype(f(*s))>(), "must be eq");
-                last_result=f(*s);
-                local_s = last_result.begin();
-                local_e = last_result.end();
+            fetch();
+        }
+
+    private:
+
+        // empty results are skipped, the iterator only stops at a value or at the end
+        void fetch(){
+            while (local_s == local_e && s != e){
+                auto& results = last_result.refill();
+                detail::demux_fill(f, *s, results);
+                local_s = results.begin();
+                local_e = results.end();
                 s++;
             }
         }
 
+    public:
+
         self_type& operator++(){
             plusplus();
             return *this;
@@ -147,13 +356,14 @@ namespace it{
     };
 } // it namespace
 
-   template <typename FuncType, typename Container, typename Storage_type>
+   template <typename FuncType, typename Container, typename Storage_type, typename Policy = detail::policy_of_t<Container>>
     using demux_t = detail::chaineable_t<
                             FuncType,
                             Container,
                             Storage_type,
                             typename detail::get_lambda<FuncType,Container>::return_type::value_type,
-                            it::DemuxIterator<typename detail::get_lambda<FuncType,Container>::return_type::value_type, typename Container::iterator, FuncType > // specific iterator type for demuxation
+                            it::DemuxIterator<typename detail::get_lambda<FuncType,Container>::return_type::value_type, typename Container::iterator, FuncType >, // specific iterator type for demuxation
+                            Policy
                                 >;
 
 
@@ -188,4 +398,101 @@ namespace it{
     demux(F f, C&& c){
         return demux_t<F,C,detail::Value_storage> (f, detail::chaineable_store_t<C,detail::Value_storage> (std::move(c)));
     }
+
+    // with execution policy
+    // lvalue collection
+    template <typename P, typename F, typename C, typename = detail::enable_if_policy_t<P>>
+    demux_t<F, C, detail::Reference_storage, P>
+    demux(const P&, F f, C& c){
+        return demux_t<F,C,detail::Reference_storage,P> (f, detail::chaineable_store_t<C,detail::Reference_storage> (c));
+    }
+
+    // with execution policy
+    // xvalue collection
+    template <typename P, typename F, typename C, typename = detail::enable_if_policy_t<P>>
+    demux_t<F, C, detail::Value_storage, P>
+    demux(const P&, F f, C&& c){
+        return demux_t<F,C,detail::Value_storage,P> (f, detail::chaineable_store_t<C,detail::Value_storage> (std::move(c)));
+    }
+
+    // the functor returns up to N values in a static_vector<T,N>, the iterator keeps them inline
+    // lvalue collection
+    template <std::size_t N, typename F, typename C>
+    demux_t<F, C, detail::Reference_storage>
+    demux(F f, C& c){
+        static_assert(detail::is_static_vector<typename detail::get_lambda<F,C>::return_type, N>::value,
+                      "the functor must return a func::static_vector<T,N>");
+        return demux_t<F,C,detail::Reference_storage> (f, detail::chaineable_store_t<C,detail::Reference_storage> (c));
+    }
+
+    // xvalue collection
+    template <std::size_t N, typename F, typename C>
+    demux_t<F, C, detail::Value_storage>
+    demux(F f, C&& c){
+        static_assert(detail::is_static_vector<typename detail::get_lambda<F,C>::return_type, N>::value,
+                      "the functor must return a func::static_vector<T,N>");
+        return demux_t<F,C,detail::Value_storage> (f, detail::chaineable_store_t<C,detail::Value_storage> (std::move(c)));
+    }
+
+    // with execution policy
+    // lvalue collection
+    template <std::size_t N, typename P, typename F, typename C, typename = detail::enable_if_policy_t<P>>
+    demux_t<F, C, detail::Reference_storage, P>
+    demux(const P&, F f, C& c){
+        static_assert(detail::is_static_vector<typename detail::get_lambda<F,C>::return_type, N>::value,
+                      "the functor must return a func::static_vector<T,N>");
+        return demux_t<F,C,detail::Reference_storage,P> (f, detail::chaineable_store_t<C,detail::Reference_storage> (c));
+    }
+
+    // with execution policy
+    // xvalue collection
+    template <std::size_t N, typename P, typename F, typename C, typename = detail::enable_if_policy_t<P>>
+    demux_t<F, C, detail::Value_storage, P>
+    demux(const P&, F f, C&& c){
+        static_assert(detail::is_static_vector<typename detail::get_lambda<F,C>::return_type, N>::value,
+                      "the functor must return a func::static_vector<T,N>");
+        return demux_t<F,C,detail::Value_storage,P> (f, detail::chaineable_store_t<C,detail::Value_storage> (std::move(c)));
+    }
+
+    template <typename T, typename FuncType, typename Container, typename Storage_type, typename Policy = detail::policy_of_t<Container>, typename A = std::allocator<T>>
+    using demux_emit_t = detail::chaineable_t<
+                            detail::emitting<FuncType, T, A>,
+                            Container,
+                            Storage_type,
+                            T,
+                            it::DemuxIterator<T, typename Container::iterator, detail::emitting<FuncType, T, A>>,
+                            Policy
+                                >;
+
+    // the functor emits the values of T produced by each element: f(x, emit) calls emit(v).
+    // No collection is allocated per element, the values go to a buffer allocated with A
+    // lvalue collection
+    template <typename T, typename A = std::allocator<T>, typename F, typename C>
+    demux_emit_t<T, F, C, detail::Reference_storage, detail::policy_of_t<C>, A>
+    demux_emit(F f, C& c){
+        return demux_emit_t<T,F,C,detail::Reference_storage,detail::policy_of_t<C>,A> (f, detail::chaineable_store_t<C,detail::Reference_storage> (c));
+    }
+
+    // xvalue collection
+    template <typename T, typename A = std::allocator<T>, typename F, typename C>
+    demux_emit_t<T, F, C, detail::Value_storage, detail::policy_of_t<C>, A>
+    demux_emit(F f, C&& c){
+        return demux_emit_t<T,F,C,detail::Value_storage,detail::policy_of_t<C>,A> (f, detail::chaineable_store_t<C,detail::Value_storage> (std::move(c)));
+    }
+
+    // with execution policy
+    // lvalue collection
+    template <typename T, typename A = std::allocator<T>, typename P, typename F, typename C, typename = detail::enable_if_policy_t<P>>
+    demux_emit_t<T, F, C, detail::Reference_storage, P, A>
+    demux_emit(const P&, F f, C& c){
+        return demux_emit_t<T,F,C,detail::Reference_storage,P,A> (f, detail::chaineable_store_t<C,detail::Reference_storage> (c));
+    }
+
+    // with execution policy
+    // xvalue collection
+    template <typename T, typename A = std::allocator<T>, typename P, typename F, typename C, typename = detail::enable_if_policy_t<P>>
+    demux_emit_t<T, F, C, detail::Value_storage, P, A>
+    demux_emit(const P&, F f, C&& c){
+        return demux_emit_t<T,F,C,detail::Value_storage,P,A> (f, detail::chaineable_store_t<C,detail::Value_storage> (std::move(c)));
+    }
 }
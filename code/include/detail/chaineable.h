@@ -20,6 +20,8 @@
 #include <iterator>
 
 #include "detail/utils.h"
+#include "detail/iterators.h"
+#include "policy.h"
 
 namespace func{
 namespace detail{
@@ -67,12 +69,42 @@ namespace detail{
         C* operator-> (){ return &storage; }
     };
 
+    // collections with an exact length
+    template <typename C, typename = void>
+    struct has_size : std::false_type { };
+
+    template <typename C>
+    struct has_size<C, typename make_void<decltype(std::declval<C&>().size())>::type> : std::true_type { };
+
+    template <typename C, typename = void>
+    struct has_size_hint : std::false_type { };
+
+    template <typename C>
+    struct has_size_hint<C, typename make_void<decltype(std::declval<C&>().size_hint())>::type> : std::true_type { };
+
+    // upper bound of the length of any collection, 0 when unknown
+    template <typename C>
+    typename std::enable_if<has_size_hint<C>::value, std::size_t>::type size_hint(C& c){
+        return c.size_hint();
+    }
+
+    template <typename C>
+    typename std::enable_if<!has_size_hint<C>::value && has_size<C>::value, std::size_t>::type size_hint(C& c){
+        return c.size();
+    }
+
+    template <typename C>
+    typename std::enable_if<!has_size_hint<C>::value && !has_size<C>::value, std::size_t>::type size_hint(C&){
+        return 0;
+    }
+
     template<
              typename FuncType,         // type of the function
              typename Container,        // container type
              typename Storage_type,     // kind of storage (reference or value)
              typename Value_type,       // what values this chainable will produce
-             typename Iterator          // what kind of iterator this chaineable will provide
+             typename Iterator,         // what kind of iterator this chaineable will provide
+             typename Policy = policy_of_t<Container>   // how the chain is evaluated
                  >
     struct chaineable_t{
 
@@ -82,6 +114,7 @@ namespace detail{
       //                "the function does not accept the collection type as paramenter");
 
         using value_type = Value_type;
+        using policy_type = Policy;
         using storage_t = detail::chaineable_store_t<Container, Storage_type>;
 
         FuncType func;
@@ -98,6 +131,17 @@ namespace detail{
         chaineable_t operator= (const chaineable_t&) = delete;
         chaineable_t operator= (chaineable_t&&) = delete;
 
+        // exact length, when the iterator keeps the length of a nested collection which knows it
+        template <typename C = Container, typename = typename std::enable_if<keeps_size<Iterator>::value && has_size<C>::value>::type>
+        std::size_t size(){
+            return store->size();
+        }
+
+        // upper bound of the length, 0 when unknown
+        std::size_t size_hint(){
+            return (keeps_size<Iterator>::value || bounds_size<Iterator>::value)? detail::size_hint(*store): 0;
+        }
+
         iterator begin(){
             return iterator(func, store.storage.begin(), store.storage.end());
         }
@@ -0,0 +1,155 @@
+/**
+	FunctionalCpp,  A header only library for chainable functional operations
+	in C++ collections
+    Copyright (C) 2016 Luis F. Ayuso & Stefan Moosbrugger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include "thread_pool.h"
+
+namespace func{
+namespace detail{
+
+    // chunk boundaries are multiple of this, so two workers never write
+    // in the same cache line (or the same word of a std::vector<bool>)
+    static const std::size_t chunk_alignment = 64;
+
+    /*
+     * how a loop over [0, n) is evaluated: the first head elements sequentially,
+     * the rest split in parts. A single part means sequential evaluation.
+     */
+    struct schedule{
+        std::size_t head;
+        std::size_t parts;
+    };
+
+    /*
+     * Per element cost of a loop, measured by timing the first elements the first
+     * time it runs and cached for the following runs. Key identifies the loop: the
+     * chain type and the operation evaluating it.
+     *
+     * The work is split only if it pays off:
+     *  - below min_parallel_ns of estimated work, the loop runs sequentially.
+     *  - each part gets at least min_part_ns of work, and there are at most
+     *    parts_per_thread parts per thread, so idle threads can steal.
+     */
+    template <typename Key>
+    struct cost_model{
+
+        static const std::size_t sample_size = 256;
+        static constexpr double min_parallel_ns = 50000;
+        static constexpr double min_part_ns = 10000;
+        static const std::size_t parts_per_thread = 4;
+
+        // negative while unknown
+        static std::atomic<double>& ns_per_element(){
+            static std::atomic<double> cost(-1.0);
+            return cost;
+        }
+
+        static std::atomic<std::size_t>& samples(){
+            static std::atomic<std::size_t> count(0);
+            return count;
+        }
+
+        static void record(double ns, std::size_t count){
+            if (count == 0) return;
+            ns_per_element() = ns / count;
+            samples() = count;
+        }
+
+        // parts to split m elements into
+        static std::size_t parts_for(std::size_t m){
+            double cost = ns_per_element();
+            if (cost < 0) return 1;
+
+            double work = cost * m;
+            if (work < min_parallel_ns) return 1;
+
+            std::size_t blocks = (m + chunk_alignment -1) / chunk_alignment;
+            std::size_t threads = exec::thread_pool::instance().concurrency();
+            std::size_t parts = std::min<std::size_t>(blocks, threads * parts_per_thread);
+            parts = std::min<std::size_t>(parts, static_cast<std::size_t>(work / min_part_ns));
+            return std::max<std::size_t>(parts, 1);
+        }
+
+        /*
+         * decides how to evaluate [0, n). If the cost is not known yet, or it was sampled
+         * over fewer elements, probe(0, head) is evaluated and timed, its results are
+         * part of the evaluation.
+         */
+        template <typename Probe>
+        static schedule plan(std::size_t n, Probe& probe){
+            std::size_t head = 0;
+            std::size_t wanted = n < sample_size? n: sample_size;
+            if (samples() < wanted){
+                head = wanted;
+                auto start = std::chrono::steady_clock::now();
+                probe(std::size_t(0), head);
+                auto end = std::chrono::steady_clock::now();
+                record(std::chrono::duration<double, std::nano>(end - start).count(), head);
+            }
+            return schedule { head, parts_for(n - head) };
+        }
+    };
+
+    template <typename Key> const std::size_t cost_model<Key>::sample_size;
+    template <typename Key> constexpr double cost_model<Key>::min_parallel_ns;
+    template <typename Key> constexpr double cost_model<Key>::min_part_ns;
+    template <typename Key> const std::size_t cost_model<Key>::parts_per_thread;
+
+    // beginning of part p of the elements after the head, multiple of the alignment
+    inline std::size_t part_bound(const schedule& s, std::size_t n, std::size_t p){
+        if (p >= s.parts) return n;
+        std::size_t offset = (n - s.head) * p / s.parts;
+        offset = (offset + chunk_alignment -1) / chunk_alignment * chunk_alignment;
+        return std::min(n, s.head + offset);
+    }
+
+    // runs body(p, from, to) for each part after the head, concurrently when there are several
+    template <typename Body>
+    void run_parts(const schedule& s, std::size_t n, Body& body){
+        if (s.parts <= 1){
+            if (s.head < n) body(std::size_t(0), s.head, n);
+            return;
+        }
+        auto chunk = [&](std::size_t from, std::size_t to){
+            for (std::size_t p = from; p < to; ++p){
+                body(p, part_bound(s, n, p), part_bound(s, n, p+1));
+            }
+        };
+        exec::parallel_for(s.parts, chunk);
+    }
+
+    /*
+     * runs body(from, to) over [0, n), sequentially or split in chunks as the
+     * cost model of the body decides.
+     */
+    template <typename Body>
+    void adaptive_chunks(std::size_t n, Body& body){
+        schedule s = cost_model<Body>::plan(n, body);
+        auto part = [&](std::size_t, std::size_t from, std::size_t to){
+            body(from, to);
+        };
+        run_parts(s, n, part);
+    }
+
+} // detail namespace
+} // func namespace
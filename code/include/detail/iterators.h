@@ -20,6 +20,8 @@
 
 #include <type_traits>
 #include <functional>
+#include <iterator>
+#include <cstddef>
 
 namespace func {
 namespace it {
@@ -27,6 +29,8 @@ namespace it {
     struct TransformIterator;
     template <typename V, typename S, typename F>
     struct FilterIterator;
+    template <typename V, typename S, typename E>
+    struct FilterMapIterator;
     template <typename V>
     struct SequenceIterator;
     template <typename T, typename V>
@@ -35,6 +39,12 @@ namespace it {
     struct MuxIterator;
     template<typename V, typename S, typename F>
     struct DemuxIterator;
+    template <typename V>
+    struct ChannelIterator;
+}
+namespace detail {
+    template <typename Iter, typename Value>
+    struct iterator_type;
 }
 }
 
@@ -49,8 +59,8 @@ namespace std {
         using difference_type   = typename std::iterator_traits<S>::difference_type;
         using value_type        = V;
         using pointer           = const V*;
-        using reference         = const V&;
-        using iterator_category = std::input_iterator_tag;
+        using reference         = V;
+        using iterator_category = typename func::detail::iterator_type<func::it::TransformIterator<V,S,F>, V>::iterator_category;
     };
 
     template<typename V, typename S, typename F>
@@ -62,13 +72,22 @@ namespace std {
         using iterator_category = std::input_iterator_tag;
     };
 
+    template<typename V, typename S, typename E>
+    struct iterator_traits<func::it::FilterMapIterator<V,S,E>>{
+        using difference_type   = typename std::iterator_traits<S>::difference_type;
+        using value_type        = V;
+        using pointer           = const V*;
+        using reference         = const V&;
+        using iterator_category = std::input_iterator_tag;
+    };
+
     template<typename V>
     struct iterator_traits<func::it::SequenceIterator<V>>{
         using difference_type   = std::ptrdiff_t;
         using value_type        = V;
         using pointer           = V*;
-        using reference         = V&;
-        using iterator_category = std::input_iterator_tag;
+        using reference         = V;
+        using iterator_category = std::random_access_iterator_tag;
     };
 
     template<typename I, typename V>
@@ -76,8 +95,8 @@ namespace std {
         using difference_type   =  std::ptrdiff_t;
         using value_type        = V;
         using pointer           = V*;
-        using reference         = V&;
-        using iterator_category = std::input_iterator_tag;
+        using reference         = V;
+        using iterator_category = typename func::detail::iterator_type<func::it::ZipIterator<I,V>, V>::iterator_category;
     };
     template<typename V, typename S, typename F>
     struct iterator_traits<func::it::MuxIterator<V,S,F>>{
@@ -95,6 +114,14 @@ namespace std {
         using reference         = const V&;
         using iterator_category = std::input_iterator_tag;
     };
+    template<typename V>
+    struct iterator_traits<func::it::ChannelIterator<V>>{
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = V;
+        using pointer           = const V*;
+        using reference         = const V&;
+        using iterator_category = std::input_iterator_tag;
+    };
 }
 
 
@@ -104,66 +131,245 @@ namespace detail {
     template <typename Iter>
     using is_ra_iterator = typename std::is_same<typename std::iterator_traits<Iter>::iterator_category, std::random_access_iterator_tag>;
 
-    template <typename Iter, typename Value, typename Category>
+    template <typename Iter, typename Value>
     struct iterator_type_aux;
 
     template <typename Iter, typename Value>
-    struct iterator_type : public std::iterator<std::input_iterator_tag, Value> {
-        static const bool is_parallel_iterator = iterator_type_aux<
-                                                            Iter,
-                                                            Value,
-                                                            typename std::iterator_traits<Iter>::iterator_category
-                                                      >::is_parallel_iterator;
+    struct iterator_parallelism {
+        static const bool value = iterator_type_aux<Iter, Value>::is_parallel_iterator;
+    };
+
+    // parallel iterators model RandomAccessIterator, the rest are input iterators
+    template <typename Iter, typename Value>
+    struct iterator_type : public std::iterator<typename std::conditional<iterator_parallelism<Iter, Value>::value,
+                                                                          std::random_access_iterator_tag,
+                                                                          std::input_iterator_tag>::type,
+                                                Value> {
+        static const bool is_parallel_iterator = iterator_parallelism<Iter, Value>::value;
     };
 
-    template <typename Value, typename Source, typename Func, typename Category>
-    struct iterator_type_aux<it::TransformIterator<Value, Source, Func>, Value, Category> {
-        static const bool is_parallel_iterator = iterator_type<Source, Value>::is_parallel_iterator;
+    // NOTE: the value produced by a nested iterator does not need to match the one of
+    // the iterator that wraps it (i.e. transform int -> float), therefore the specializations
+    // match any inner value type.
+
+    template <typename Inner, typename Source, typename Func, typename Value>
+    struct iterator_type_aux<it::TransformIterator<Inner, Source, Func>, Value> {
+        static const bool is_parallel_iterator = iterator_type<Source, Inner>::is_parallel_iterator;
+    };
+
+    template <typename Inner, typename Source, typename Func, typename Value>
+    struct iterator_type_aux<it::FilterIterator<Inner, Source, Func>, Value> {
+        static const bool is_parallel_iterator = false;
     };
 
-    template <typename Value, typename Source, typename Func, typename Category>
-    struct iterator_type_aux<it::FilterIterator<Value, Source, Func>, Value, Category> {
+    template <typename Inner, typename Source, typename Expr, typename Value>
+    struct iterator_type_aux<it::FilterMapIterator<Inner, Source, Expr>, Value> {
         static const bool is_parallel_iterator = false;
     };
 
-    template <typename Value, typename Category>
-    struct iterator_type_aux<it::SequenceIterator<Value>, Value, Category> {
+    template <typename Inner, typename Value>
+    struct iterator_type_aux<it::SequenceIterator<Inner>, Value> {
         static const bool is_parallel_iterator = true;
     };
 
-    template <typename Value, typename Source, typename Func, typename Category>
-    struct iterator_type_aux<it::MuxIterator<Value, Source, Func>, Value, Category> {
+    template <typename Inner, typename Source, typename Func, typename Value>
+    struct iterator_type_aux<it::MuxIterator<Inner, Source, Func>, Value> {
         static const bool is_parallel_iterator = false;
     };
 
-    template <typename Value, typename Source, typename Func, typename Category>
-    struct iterator_type_aux<it::DemuxIterator<Value, Source, Func>, Value, Category> {
+    template <typename Inner, typename Source, typename Func, typename Value>
+    struct iterator_type_aux<it::DemuxIterator<Inner, Source, Func>, Value> {
         static const bool is_parallel_iterator = false;
     };
 
-    template <typename Source, typename Value, typename Category>
-    struct iterator_type_aux<it::ZipIterator<Source, Value>, Value, Category> {
+    template <typename Inner, typename Value>
+    struct iterator_type_aux<it::ChannelIterator<Inner>, Value> {
+        static const bool is_parallel_iterator = false;
+    };
+
+    template <typename Source, typename Inner, typename Value>
+    struct iterator_type_aux<it::ZipIterator<Source, Inner>, Value> {
         using first_iter = typename std::tuple_element<0,Source>::type;
-        using first_value = typename std::tuple_element<0,Value>::type;
+        using first_value = typename std::decay<typename std::tuple_element<0,Inner>::type>::type;
         using new_iter_tuple = typename detail::remove_first_type<Source>::type;
-        using new_value_tuple = typename detail::remove_first_type<Value>::type;
+        using new_value_tuple = typename detail::remove_first_type<Inner>::type;
 
         static const bool is_parallel_iterator = iterator_type<first_iter, first_value>::is_parallel_iterator &&
                     iterator_type<it::ZipIterator<new_iter_tuple, new_value_tuple>, new_value_tuple>::is_parallel_iterator;
     };
 
-    template <typename Category>
-    struct iterator_type_aux<it::ZipIterator<std::tuple<>, std::tuple<>>, std::tuple<>, Category> {
+    template <typename Value>
+    struct iterator_type_aux<it::ZipIterator<std::tuple<>, std::tuple<>>, Value> {
         static const bool is_parallel_iterator = true;
     };
 
-    template <typename Iter, typename Value, typename Category>
+    // any other iterator: the category of the library iterators depends on whether they can be accessed
+    // in parallel, so the standard traits are only queried here.
+    template <typename Iter, typename Value>
     struct iterator_type_aux {
-        static const bool is_parallel_iterator = std::is_same<Category, std::random_access_iterator_tag>();
+        static const bool is_parallel_iterator = std::is_same<typename std::iterator_traits<Iter>::iterator_category, std::random_access_iterator_tag>();
     };
 
     template <typename Iter, typename Value>
     using iterator_type_t = typename iterator_type<Iter, Value>::type;
 
+    // what the length of the nested collection tells about the length of a chain:
+    // transforms keep it, filters and muxes produce at most as many elements.
+    template <typename Iter>
+    struct keeps_size {
+        static const bool value = false;
+    };
+
+    template <typename V, typename S, typename F>
+    struct keeps_size<it::TransformIterator<V, S, F>> {
+        static const bool value = true;
+    };
+
+    template <typename Iter>
+    struct bounds_size {
+        static const bool value = false;
+    };
+
+    template <typename V, typename S, typename F>
+    struct bounds_size<it::FilterIterator<V, S, F>> {
+        static const bool value = true;
+    };
+
+    template <typename V, typename S, typename E>
+    struct bounds_size<it::FilterMapIterator<V, S, E>> {
+        static const bool value = true;
+    };
+
+    template <typename V, typename S, typename F>
+    struct bounds_size<it::MuxIterator<V, S, F>> {
+        static const bool value = true;
+    };
+
+    /*
+     * iterators which know where their collection ends (filters, muxes, sequences, zips) answer
+     * at_end() with a single check. Whoever iterates them does not need to keep an end copy.
+     */
+    template <typename Iter>
+    struct self_terminating {
+    private:
+        template <typename I>
+        static auto test(int) -> decltype(std::declval<const I&>().at_end(), std::true_type());
+        template <typename I>
+        static std::false_type test(...);
+    public:
+        static const bool value = decltype(test<Iter>(0))::value;
+    };
+
+    // what is kept to know the end of an iterator: nothing for the self terminating ones
+    struct no_end {
+        no_end() {}
+        template <typename Iter>
+        no_end(const Iter&) {}
+    };
+
+    template <typename Iter>
+    using end_slot_t = typename std::conditional<self_terminating<Iter>::value, no_end, Iter>::type;
+
+    template <typename Iter>
+    bool at_end(const Iter& it, const no_end&){
+        return it.at_end();
+    }
+
+    template <typename Iter>
+    bool at_end(const Iter& it, const Iter& end){
+        return it == end;
+    }
+
+    // elements left before the end, for random access iterators
+    template <typename Iter>
+    std::ptrdiff_t remaining(const Iter& it, const no_end&){
+        return it.remaining();
+    }
+
+    template <typename Iter>
+    std::ptrdiff_t remaining(const Iter& it, const Iter& end){
+        return end - it;
+    }
+
+    /*
+     * block protocol: next_block(it, end, out, n) moves it over up to n elements and writes
+     * them to out, returning how many. It returns 0 only at the end. The library iterators
+     * implement it as a member, any other random access iterator takes a counted loop
+     * and the rest go element by element.
+     */
+    template <typename Iter>
+    struct has_next_block {
+    private:
+        template <typename I>
+        static auto test(int) -> decltype(std::declval<I&>().next_block(std::declval<typename std::iterator_traits<I>::value_type*>(),
+                                                                         std::size_t(), std::declval<const I&>()), std::true_type());
+        template <typename I>
+        static std::false_type test(...);
+    public:
+        static const bool value = decltype(test<Iter>(0))::value;
+    };
+
+    template <typename Iter, typename T>
+    typename std::enable_if<has_next_block<Iter>::value, std::size_t>::type
+    next_block(Iter& it, const Iter& end, T* out, std::size_t n){
+        return it.next_block(out, n, end);
+    }
+
+    template <typename Iter, typename T>
+    typename std::enable_if<!has_next_block<Iter>::value && is_ra_iterator<Iter>::value, std::size_t>::type
+    next_block(Iter& it, const Iter& end, T* out, std::size_t n){
+        std::size_t left = end - it;
+        std::size_t m = n < left? n: left;
+        for (std::size_t i = 0; i < m; ++i){
+            out[i] = it[i];
+        }
+        it += m;
+        return m;
+    }
+
+    template <typename Iter, typename T>
+    typename std::enable_if<!has_next_block<Iter>::value && !is_ra_iterator<Iter>::value, std::size_t>::type
+    next_block(Iter& it, const Iter& end, T* out, std::size_t n){
+        std::size_t k = 0;
+        for (; k < n && it != end; ++k, ++it){
+            out[k] = *it;
+        }
+        return k;
+    }
+
+    // elements per block in the terminal operations, the buffer takes at most 16KB
+    template <typename T>
+    constexpr std::size_t block_size(){
+        return sizeof(T) >= 16*1024? 1: (16*1024/sizeof(T) < 1024? 16*1024/sizeof(T): 1024);
+    }
+
+    // chains of library iterators are consumed in blocks, when their values can be kept in a buffer.
+    // Random access chains are not, their loops are already counted and fused
+    template <typename C>
+    struct is_block_chain {
+        using iterator = decltype(std::declval<C&>().begin());
+        using value_type = typename std::iterator_traits<iterator>::value_type;
+        static const bool value = has_next_block<iterator>::value && !is_ra_iterator<iterator>::value &&
+                                  std::is_default_constructible<value_type>::value && std::is_copy_assignable<value_type>::value;
+    };
+
+    // calls g(block, m) for every block of the collection, the block is overwritten afterwards
+    template <typename C, typename G>
+    void for_each_block(C& c, G&& g){
+        using value = typename is_block_chain<C>::value_type;
+        value buffer[block_size<value>()];
+        auto it = c.begin();
+        auto end = c.end();
+        while (std::size_t m = next_block(it, end, buffer, block_size<value>())){
+            g(buffer, m);
+        }
+    }
+
+    // shortcut to query any iterator, library provided or not.
+    template <typename Iter>
+    struct is_parallel_iterator {
+        static const bool value = iterator_type<Iter, typename std::iterator_traits<Iter>::value_type>::is_parallel_iterator;
+    };
+
 } // end namespace detail
 } // end namespace func
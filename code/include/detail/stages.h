@@ -0,0 +1,152 @@
+/**
+	FunctionalCpp,  A header only library for chainable functional operations
+	in C++ collections
+    Copyright (C) 2016 Luis F. Ayuso & Stefan Moosbrugger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <utility>
+
+namespace func{
+namespace detail{
+
+    /*
+     * nested transforms and filters are fused into a single iterator over the innermost source.
+     * The fused stage is described by a type expression:
+     *  - F:              a transform
+     *  - composed<F, G>: the transform F applied to the values of the transforms G
+     *  - kept<P, E>:     the values of E which satisfy P
+     *  - mapped<F, E>:   the transform F applied to the values of E, when E contains filters
+     *  - identity_stage: the elements of the source, the base of a filter
+     */
+    template <typename F, typename G>
+    struct composed;
+
+    template <typename P, typename E>
+    struct kept;
+
+    template <typename F, typename E>
+    struct mapped;
+
+    struct identity_stage;
+
+    // how an iterator reaches the functors of a transform stage: by address, and for
+    // composed stages through the addresses of every fused functor
+    template <typename F>
+    struct stage_fn{
+        F* f;
+
+        stage_fn() : f(nullptr) {}
+        stage_fn(F& f) : f(&f) {}
+
+        template <typename X>
+        auto operator()(X&& x) const -> decltype((*f)(std::forward<X>(x))){
+            return (*f)(std::forward<X>(x));
+        }
+    };
+
+    template <typename F, typename G>
+    struct stage_fn<composed<F, G>>{
+        stage_fn<F> f;
+        stage_fn<G> g;
+
+        stage_fn() {}
+        stage_fn(F& f, const stage_fn<G>& g) : f(f), g(g) {}
+
+        template <typename X>
+        auto operator()(X&& x) const -> decltype(f(g(std::forward<X>(x)))){
+            return f(g(std::forward<X>(x)));
+        }
+    };
+
+    // the functor of the outermost transform of a composed stage
+    template <typename F>
+    struct outer_fn{
+        using type = F;
+    };
+
+    template <typename F, typename G>
+    struct outer_fn<composed<F, G>>{
+        using type = F;
+    };
+
+    /*
+     * stages containing filters are evaluated in continuation passing style: the value which
+     * survives every filter is handed to k, and the result tells whether there was one.
+     */
+    template <typename E>
+    struct stage_cps{
+        stage_fn<E> f;
+
+        stage_cps() {}
+        stage_cps(const stage_fn<E>& f) : f(f) {}
+
+        template <typename X, typename K>
+        bool operator()(X&& x, K&& k) const{
+            return k(f(std::forward<X>(x)));
+        }
+    };
+
+    template <>
+    struct stage_cps<identity_stage>{
+
+        template <typename X, typename K>
+        bool operator()(X&& x, K&& k) const{
+            return k(std::forward<X>(x));
+        }
+    };
+
+    template <typename P, typename E>
+    struct stage_cps<kept<P, E>>{
+        stage_fn<P> p;
+        stage_cps<E> e;
+
+        stage_cps() {}
+        stage_cps(P& p, const stage_cps<E>& e = stage_cps<E>()) : p(p), e(e) {}
+
+        template <typename X, typename K>
+        bool operator()(X&& x, K&& k) const{
+            return e(std::forward<X>(x), [&](auto&& y){ return outer(std::forward<decltype(y)>(y), k); });
+        }
+
+        // only the outermost filter, for values already produced by e
+        template <typename Y, typename K>
+        bool outer(Y&& y, K&& k) const{
+            return p(y)? k(std::forward<Y>(y)): false;
+        }
+    };
+
+    template <typename F, typename E>
+    struct stage_cps<mapped<F, E>>{
+        stage_fn<F> f;
+        stage_cps<E> e;
+
+        stage_cps() {}
+        stage_cps(F& f, const stage_cps<E>& e) : f(f), e(e) {}
+
+        template <typename X, typename K>
+        bool operator()(X&& x, K&& k) const{
+            return e(std::forward<X>(x), [&](auto&& y){ return outer(std::forward<decltype(y)>(y), k); });
+        }
+
+        template <typename Y, typename K>
+        bool outer(Y&& y, K&& k) const{
+            return k(f(std::forward<Y>(y)));
+        }
+    };
+
+} // end namespace detail
+} // end namespace func
@@ -21,6 +21,7 @@
 #include <type_traits>
 #include <functional>
 #include <tuple>
+#include <new>
 
 namespace func {
 namespace detail {
@@ -180,5 +181,64 @@ namespace detail {
         using type = std::tuple<T2>;
     };
 
+    /*
+     * storage for a value which may be absent, as std::optional does. Used to keep
+     * computed values in iterators: unlike a plain member it does not require the
+     * value to be default constructible nor assignable (std::pair<const K, V>)
+     */
+    template <typename T>
+    class cached_value{
+
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+        bool engaged;
+
+    public:
+
+        cached_value() : engaged(false) {}
+
+        cached_value(const cached_value& o) : engaged(false) {
+            if (o.engaged) emplace(o.get());
+        }
+
+        cached_value(cached_value&& o) : engaged(false) {
+            if (o.engaged) emplace(std::move(o.get()));
+        }
+
+        cached_value& operator= (const cached_value& o){
+            if (this == &o) return *this;
+            reset();
+            if (o.engaged) emplace(o.get());
+            return *this;
+        }
+
+        cached_value& operator= (cached_value&& o){
+            if (this == &o) return *this;
+            reset();
+            if (o.engaged) emplace(std::move(o.get()));
+            return *this;
+        }
+
+        ~cached_value(){
+            reset();
+        }
+
+        template <typename... Args>
+        void emplace(Args&&... args){
+            reset();
+            new (&storage) T(std::forward<Args>(args)...);
+            engaged = true;
+        }
+
+        void reset(){
+            if (engaged) get().~T();
+            engaged = false;
+        }
+
+        bool has_value() const { return engaged; }
+
+        T& get() { return *reinterpret_cast<T*>(&storage); }
+        const T& get() const { return *reinterpret_cast<const T*>(&storage); }
+    };
+
 } // end namespace detail
 } // end namespace func
@@ -23,6 +23,8 @@
 #include "detail/utils.h"
 #include "detail/iterators.h"
 #include "detail/chaineable.h"
+#include "detail/stages.h"
+#include "transform.h"
 
 namespace func{
 namespace it{
@@ -33,41 +35,44 @@ namespace it{
         Source s;
         Source end;
         bool finish;
+        // the source is dereferenced once per element, the value is kept
+        // for the predicate and for the consumer
+        detail::cached_value<Value> current;
 
         using self_type = FilterIterator<Value, Source, Func>;
 
         FilterIterator(Func& f, const Source& beg, const Source& end)
         :f(f), s(beg), end(end) {
-            while(s != end && !f(*s)){
-                ++s;
-            }
-            finish = end == s;
+            seek();
         }
 
         FilterIterator(const FilterIterator& o)
-          : f(o.f), s(o.s), end(o.end), finish(o.finish){ }
+          : f(o.f), s(o.s), end(o.end), finish(o.finish), current(o.current){ }
 
         FilterIterator(FilterIterator&& o)
-          : f(o.f), s(std::move(o.s)), end(std::move(o.end)), finish(o.finish) { }
+          : f(o.f), s(std::move(o.s)), end(std::move(o.end)), finish(o.finish), current(std::move(o.current)) { }
 
         FilterIterator& operator= (const FilterIterator& o){
             s = o.s;
             end = o.end;
             finish = o.finish;
+            current = o.current;
             return *this;
         }
         FilterIterator& operator= (FilterIterator&& o){
             std::swap(s, o.s);
             std::swap(end, o.end);
             finish = o.finish;
+            current = std::move(o.current);
             return *this;
         }
 
+        // against a finished iterator, the end, it is a single check
         template <typename A, typename B, typename F>
         bool operator == (const FilterIterator<A,B,F>& o) const{
             static_assert(std::is_same<A, Value>::value, "incompatible iterators");
             static_assert(std::is_same<B, Source>::value, "incompatible iterators");
-            if (finish && finish == o.finish) return true;
+            if (finish || o.finish) return finish == o.finish;
             return s == o.s;
         }
 
@@ -78,38 +83,225 @@ namespace it{
             return !(*this == o);
         }
 
+        bool at_end() const{
+            return finish;
+        }
+
         Value operator* (){
             assert(s != end && "deref and end iterator");
-            return *s;
+            return current.get();
         }
 
         self_type& operator++(){
             assert(s != end && "move and end iterator");
-            do{
-                ++s;
-            }while(s != end && !f(*s));
-            finish = end == s;
+            ++s;
+            seek();
             return *this;
         }
         self_type operator++(int){
             assert(s != end && "move and end iterator");
             self_type cpy= *this;
-            do{
+            ++s;
+            seek();
+            return cpy;
+        }
+
+        // blocks of the source are compacted in place: every element is written at the
+        // cursor, which only advances over the survivors. No branch to mispredict.
+        std::size_t next_block(Value* out, std::size_t n, const self_type&){
+            if (finish || n == 0) return 0;
+            std::size_t k = 0;
+            out[k++] = std::move(current.get());
+            ++s;
+            while (k < n){
+                Value* block = out + k;
+                std::size_t m = detail::next_block(s, end, block, n - k);
+                if (m == 0) break;
+                for (std::size_t i = 0; i < m; ++i){
+                    bool keep = f(block[i]);
+                    out[k] = block[i];
+                    k += keep;
+                }
+            }
+            seek();
+            return k;
+        }
+
+    private:
+
+        // moves to the first element satisfying the predicate, starting at the current one
+        void seek(){
+            while (s != end){
+                current.emplace(*s);
+                if (f(current.get())) break;
                 ++s;
-            }while(s != end && !f(*s));
+            }
+            if (s == end) current.reset();
             finish = end == s;
+        }
+    };
+
+    /*
+     * fused filters and transforms: the whole sequence of stages runs once per source element,
+     * rejected elements are skipped without going through the nested iterators.
+     */
+    template<typename Value, typename Source, typename Expr>
+    struct FilterMapIterator: public detail::iterator_type<FilterMapIterator<Value, Source, Expr>, Value>  {
+
+        detail::stage_cps<Expr> f;
+        Source s;
+        Source end;
+        bool finish;
+        detail::cached_value<Value> current;
+
+        using source_type = Source;
+        using self_type = FilterMapIterator<Value, Source, Expr>;
+
+        FilterMapIterator()
+        : f(), s(), end(), finish(true) {}
+
+        // a filter on top of a transform
+        template <typename F, typename A, typename G>
+        FilterMapIterator(F& f, const TransformIterator<A,Source,G>& beg, const TransformIterator<A,Source,G>& end)
+        : f(f, detail::stage_cps<G>(beg.f)), s(beg.s), end(end.s) {
+            seek();
+        }
+
+        // on top of a filter, which already found its first element
+        template <typename F, typename A, typename P>
+        FilterMapIterator(F& f, const FilterIterator<A,Source,P>& beg, const FilterIterator<A,Source,P>&)
+        : f(f, detail::stage_cps<detail::kept<P, detail::identity_stage>>(beg.f)), s(beg.s), end(beg.end) {
+            resume(beg.finish, beg.current);
+        }
+
+        template <typename F, typename A, typename E>
+        FilterMapIterator(F& f, const FilterMapIterator<A,Source,E>& beg, const FilterMapIterator<A,Source,E>&)
+        : f(f, beg.f), s(beg.s), end(beg.end) {
+            resume(beg.finish, beg.current);
+        }
+
+        bool operator == (const FilterMapIterator& o) const{
+            if (finish || o.finish) return finish == o.finish;
+            return s == o.s;
+        }
+
+        bool operator != (const FilterMapIterator& o) const{
+            return !(*this == o);
+        }
+
+        bool at_end() const{
+            return finish;
+        }
+
+        Value operator* (){
+            assert(!finish && "deref and end iterator");
+            return current.get();
+        }
+
+        self_type& operator++(){
+            assert(!finish && "move and end iterator");
+            ++s;
+            seek();
+            return *this;
+        }
+        self_type operator++(int){
+            assert(!finish && "move and end iterator");
+            self_type cpy= *this;
+            ++s;
+            seek();
             return cpy;
         }
+
+        std::size_t next_block(Value* out, std::size_t n, const self_type&){
+            if (finish || n == 0) return 0;
+            std::size_t k = 0;
+            out[k++] = std::move(current.get());
+            auto keep = [&](auto&& v){ out[k] = std::forward<decltype(v)>(v); return true; };
+            for (++s; k < n && s != end; ++s){
+                k += f(*s, keep);
+            }
+            seek();
+            return k;
+        }
+
+        // evaluates the stages on the element at it, k receives the value if it survives
+        template <typename K>
+        bool visit(const Source& it, K&& k) const{
+            return f(*it, std::forward<K>(k));
+        }
+
+    private:
+
+        // moves to the first element surviving every stage, starting at the current one
+        void seek(){
+            auto keep = [this](auto&& v){ current.emplace(std::forward<decltype(v)>(v)); return true; };
+            while (s != end){
+                if (f(*s, keep)) break;
+                ++s;
+            }
+            if (s == end) current.reset();
+            finish = end == s;
+        }
+
+        // the first value of the nested filter only goes through the outermost stage
+        template <typename Cached>
+        void resume(bool done, const Cached& first){
+            auto keep = [this](auto&& v){ current.emplace(std::forward<decltype(v)>(v)); return true; };
+            if (!done){
+                if (f.outer(first.get(), keep)){
+                    finish = false;
+                    return;
+                }
+                ++s;
+            }
+            seek();
+        }
     };
 } // it namespace
 
-    template <typename FuncType, typename Container, typename Storage_type>
+namespace detail{
+
+    // a filter over a transform or over another filter iterates directly the innermost source
+    template <typename Value, typename Source, typename Func>
+    struct filter_iterator{
+        using type = it::FilterIterator<Value, Source, Func>;
+    };
+
+    template <typename Value, typename A, typename S, typename G, typename Func>
+    struct filter_iterator<Value, it::TransformIterator<A, S, G>, Func>{
+        using type = it::FilterMapIterator<Value, S, kept<Func, G>>;
+    };
+
+    template <typename Value, typename A, typename S, typename P, typename Func>
+    struct filter_iterator<Value, it::FilterIterator<A, S, P>, Func>{
+        using type = it::FilterMapIterator<Value, S, kept<Func, kept<P, identity_stage>>>;
+    };
+
+    template <typename Value, typename A, typename S, typename E, typename Func>
+    struct filter_iterator<Value, it::FilterMapIterator<A, S, E>, Func>{
+        using type = it::FilterMapIterator<Value, S, kept<Func, E>>;
+    };
+
+    // and so does a transform over a filter
+    template <typename Value, typename A, typename S, typename P, typename Func>
+    struct transform_iterator<Value, it::FilterIterator<A, S, P>, Func>{
+        using type = it::FilterMapIterator<Value, S, mapped<Func, kept<P, identity_stage>>>;
+    };
+
+    template <typename Value, typename A, typename S, typename E, typename Func>
+    struct transform_iterator<Value, it::FilterMapIterator<A, S, E>, Func>{
+        using type = it::FilterMapIterator<Value, S, mapped<Func, E>>;
+    };
+}
+
+    template <typename FuncType, typename Container, typename Storage_type, typename Policy = detail::policy_of_t<Container>>
     using filter_t = detail::chaineable_t<
                             FuncType,
                             Container,
                             Storage_type,
                             typename Container::value_type,
-                            it::FilterIterator<typename Container::value_type, typename Container::iterator, FuncType > // specific iterator type for transformation
+                            typename detail::filter_iterator<typename Container::value_type, typename Container::iterator, FuncType >::type, // specific iterator type for filtering
+                            Policy
                                 >;
 
     // for function type
@@ -126,6 +318,22 @@ namespace it{
         return filter_t<FuncType,C,detail::Value_storage> (f, detail::chaineable_store_t<C,detail::Value_storage> (std::move(c)));
     }
 
+    // with execution policy
+    // lvalue collection
+    template <typename P, typename F, typename C, typename = detail::enable_if_policy_t<P>>
+    filter_t<F, C, detail::Reference_storage, P>
+    filter(const P&, F f, C& c){
+        return filter_t<F,C,detail::Reference_storage,P> (f, detail::chaineable_store_t<C,detail::Reference_storage> (c));
+    }
+
+    // with execution policy
+    // xvalue collection
+    template <typename P, typename F, typename C, typename = detail::enable_if_policy_t<P>>
+    filter_t<F, C, detail::Value_storage, P>
+    filter(const P&, F f, C&& c){
+        return filter_t<F,C,detail::Value_storage,P> (f, detail::chaineable_store_t<C,detail::Value_storage> (std::move(c)));
+    }
+
 //    // for lambda type
 //    // lvalue collection
 //    template <typename FuncType, typename C>
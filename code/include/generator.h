@@ -18,6 +18,7 @@
 */
 #pragma once
 #include <iterator>
+#include <limits>
 
 #include "detail/utils.h"
 #include "detail/iterators.h"
@@ -30,7 +31,7 @@ namespace it{
     struct SequenceIterator: public detail::iterator_type<SequenceIterator<Value>, Value> {
 
         Value v;
-        const Value step;
+        Value step;
         size_t count;
 
         using self_type = SequenceIterator<Value>;
@@ -39,7 +40,7 @@ namespace it{
         : v(v), step(step), count(count) { }
 
         SequenceIterator()
-        : count(0), step() {}
+        : v(), step(), count(0) {}
 
         SequenceIterator(const SequenceIterator& o)
         : v(o.v), step(o.step), count(o.count) { }
@@ -49,14 +50,14 @@ namespace it{
 
         SequenceIterator& operator= (const SequenceIterator& o){
             v = o.v;
+            step = o.step;
             count = o.count;
-            assert(step == o.step && "step differs");
             return *this;
         }
         SequenceIterator& operator= (SequenceIterator&& o){
             v = o.v;
+            step = o.step;
             count = o.count;
-            assert(step == o.step && "step differs");
             return *this;
         }
 
@@ -68,10 +69,19 @@ namespace it{
             return !(*this == o);
         }
 
-        Value operator* (){
+        bool at_end() const{
+            return count == 0;
+        }
+
+        // unbounded sequences are longer than any other collection
+        std::ptrdiff_t remaining() const{
+            return clamp(count);
+        }
+
+        Value operator* () const{
             return v;
         }
-        Value* operator->(){
+        const Value* operator->() const{
             return &v;
         }
 
@@ -89,33 +99,73 @@ namespace it{
             return cpy;
         }
 
-        template <typename S = self_type, typename = typename std::enable_if<S::is_parallel_iterator>::type>
-        Value operator[](unsigned i) {
-            assert(count-i > 0 && "sequence generator limit reached.");
-            return v+i*step;
+        // the values accumulate the step, as when moving one by one
+        std::size_t next_block(Value* out, std::size_t n, const self_type&){
+            std::size_t m = n < count? n: count;
+            for (std::size_t i = 0; i < m; ++i){
+                out[i] = v;
+                v += step;
+            }
+            count -= m;
+            return m;
         }
 
-        template <typename S = self_type, typename = typename std::enable_if<S::is_parallel_iterator>::type>
-        S operator+ (int i) {
+        self_type& operator--(){
+            ++count;
+            v -= step;
+            return *this;
+        }
+        self_type operator--(int){
             self_type cpy = *this;
-            assert(count-i > 0 && "sequence generator limit reached.");
-            cpy.v+=i*step;
-            cpy.count-=i;
+            --*this;
             return cpy;
         }
 
-        template <typename S = self_type, typename = typename std::enable_if<S::is_parallel_iterator>::type>
-        S operator- (int i) {
+        Value operator[](std::ptrdiff_t i) const {
+            assert(i < remaining() && "sequence generator limit reached.");
+            return v+i*step;
+        }
+
+        self_type& operator+= (std::ptrdiff_t i) {
+            assert(i <= remaining() && "sequence generator limit reached.");
+            v+=i*step;
+            count-=i;
+            return *this;
+        }
+
+        self_type& operator-= (std::ptrdiff_t i) {
+            return *this += -i;
+        }
+
+        self_type operator+ (std::ptrdiff_t i) const {
             self_type cpy = *this;
-            assert(count+i > 0 && "sequence generator limit reached.");
-            cpy.v-=i*step;
-            cpy.count+=i;
-            return cpy;
+            return cpy += i;
+        }
+
+        self_type operator- (std::ptrdiff_t i) const {
+            self_type cpy = *this;
+            return cpy -= i;
+        }
+
+        std::ptrdiff_t operator- (const self_type& o) const {
+            // count holds the remaining elements, the further we are the smaller it gets.
+            // the difference is taken unsigned, counts of unbounded sequences do not fit a ptrdiff
+            return o.count >= count? clamp(o.count-count): -clamp(count-o.count);
+        }
+
+        bool operator< (const self_type& o) const { return o.count < count; }
+        bool operator> (const self_type& o) const { return count < o.count; }
+        bool operator<= (const self_type& o) const { return !(count < o.count); }
+        bool operator>= (const self_type& o) const { return !(o.count < count); }
+
+        friend self_type operator+ (std::ptrdiff_t i, const self_type& it) {
+            return it + i;
         }
 
-        template <typename S = self_type, typename = typename std::enable_if<S::is_parallel_iterator>::type>
-        typename std::iterator_traits<S>::difference_type operator- (const S& o) {
-            return count-o.count;
+    private:
+
+        static std::ptrdiff_t clamp(std::size_t n){
+            return n > std::size_t(std::numeric_limits<std::ptrdiff_t>::max())? std::numeric_limits<std::ptrdiff_t>::max(): std::ptrdiff_t(n);
         }
     };
 } // it namespace
@@ -137,6 +187,15 @@ namespace it{
         : init(init), step(step), count(count)
         {}
 
+        std::size_t size() const {
+            return count;
+        }
+
+        // an unbounded sequence has no length to reserve for
+        std::size_t size_hint() const {
+            return count == std::numeric_limits<size_t>::max()? 0: count;
+        }
+
         iterator begin() {
             return iterator(init, step, count);
         }
@@ -76,6 +76,11 @@ namespace it{
             return !(*this == o);
         }
 
+        // the source is consumed and its last value was visited
+        bool at_end() const{
+            return s == e && !pre_end;
+        }
+
         Value operator* () const{
             return last_value;
         }
@@ -95,6 +100,15 @@ namespace it{
             return *this;
         }
 
+        // every value is produced by f on its own, the block saves the checks of the consumer
+        std::size_t next_block(Value* out, std::size_t n, const self_type&){
+            std::size_t k = 0;
+            for (; k < n && !at_end(); ++k, ++*this){
+                out[k] = last_value;
+            }
+            return k;
+        }
+
         self_type operator++(int){
             self_type cpy= *this;
             if (pre_end) {
@@ -109,13 +123,14 @@ namespace it{
     };
 } // it namespace
 
-   template <typename FuncType, typename Container, typename Storage_type>
+   template <typename FuncType, typename Container, typename Storage_type, typename Policy = detail::policy_of_t<Container>>
     using mux_t = detail::chaineable_t<
                             FuncType,
                             Container,
                             Storage_type,
                             typename detail::get_lambda_iterator<FuncType,Container>::return_type,
-                            it::MuxIterator<typename detail::get_lambda_iterator<FuncType,Container>::return_type, typename Container::iterator, FuncType > // specific iterator type for muxation
+                            it::MuxIterator<typename detail::get_lambda_iterator<FuncType,Container>::return_type, typename Container::iterator, FuncType >, // specific iterator type for muxation
+                            Policy
                                 >;
 
 
@@ -150,4 +165,20 @@ namespace it{
     mux(F f, C&& c){
         return mux_t<F,C,detail::Value_storage> (f, detail::chaineable_store_t<C,detail::Value_storage> (std::move(c)));
     }
+
+    // with execution policy
+    // lvalue collection
+    template <typename P, typename F, typename C, typename = detail::enable_if_policy_t<P>>
+    mux_t<F, C, detail::Reference_storage, P>
+    mux(const P&, F f, C& c){
+        return mux_t<F,C,detail::Reference_storage,P> (f, detail::chaineable_store_t<C,detail::Reference_storage> (c));
+    }
+
+    // with execution policy
+    // xvalue collection
+    template <typename P, typename F, typename C, typename = detail::enable_if_policy_t<P>>
+    mux_t<F, C, detail::Value_storage, P>
+    mux(const P&, F f, C&& c){
+        return mux_t<F,C,detail::Value_storage,P> (f, detail::chaineable_store_t<C,detail::Value_storage> (std::move(c)));
+    }
 }
@@ -0,0 +1,543 @@
+/**
+	FunctionalCpp,  A header only library for chainable functional operations
+	in C++ collections
+    Copyright (C) 2016 Luis F. Ayuso & Stefan Moosbrugger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <iterator>
+#include <vector>
+#include <algorithm>
+
+#include "detail/utils.h"
+#include "detail/iterators.h"
+#include "detail/chaineable.h"
+#include "policy.h"
+#include "thread_pool.h"
+#include "detail/cost_model.h"
+#include "demux.h"
+
+namespace func{
+namespace detail{
+
+    template <typename C>
+    using chain_iterator_t = decltype(std::declval<C&>().begin());
+
+    template <typename C>
+    using chain_value_t = typename std::iterator_traits<chain_iterator_t<C>>::value_type;
+
+    template <typename C>
+    struct is_parallel_chain {
+        static const bool value = is_parallel_iterator<chain_iterator_t<C>>::value;
+    };
+
+    // filters can not be accessed at random, but when the filtered collection can,
+    // the predicate can be evaluated in parallel and the survivors compacted.
+    template <typename Iter>
+    struct is_parallel_filter_iterator {
+        static const bool value = false;
+    };
+
+    template <typename Value, typename Source, typename Func>
+    struct is_parallel_filter_iterator<it::FilterIterator<Value, Source, Func>> {
+        static const bool value = is_parallel_iterator<Source>::value;
+    };
+
+    template <typename Value, typename Source, typename Expr>
+    struct is_parallel_filter_iterator<it::FilterMapIterator<Value, Source, Expr>> {
+        static const bool value = is_parallel_iterator<Source>::value;
+    };
+
+    template <typename C>
+    struct is_parallel_filter {
+        static const bool value = is_parallel_filter_iterator<chain_iterator_t<C>>::value;
+    };
+
+    // same for demux, each element of the source expands in a collection
+    template <typename Iter>
+    struct is_parallel_demux_iterator {
+        static const bool value = false;
+    };
+
+    template <typename Value, typename Source, typename Func>
+    struct is_parallel_demux_iterator<it::DemuxIterator<Value, Source, Func>> {
+        static const bool value = is_parallel_iterator<Source>::value;
+    };
+
+    template <typename C>
+    struct is_parallel_demux {
+        static const bool value = is_parallel_demux_iterator<chain_iterator_t<C>>::value;
+    };
+
+    template <typename C>
+    struct is_sequential_chain {
+        static const bool value = !is_parallel_chain<C>::value && !is_parallel_filter<C>::value && !is_parallel_demux<C>::value;
+    };
+
+    // number of parts the work is split into when the parts need to be
+    // combined afterwards
+    inline std::size_t parallel_parts(std::size_t n){
+        static const std::size_t parts_per_thread = 4;
+        std::size_t blocks = (n + chunk_alignment -1) / chunk_alignment;
+        return std::min<std::size_t>(blocks, exec::thread_pool::instance().concurrency() * parts_per_thread);
+    }
+
+    template <typename Container, typename = void>
+    struct has_reserve : std::false_type { };
+
+    template <typename Container>
+    struct has_reserve<Container, typename make_void<decltype(std::declval<Container&>().reserve(0))>::type> : std::true_type { };
+
+    template <typename Container>
+    typename std::enable_if<has_reserve<Container>::value>::type reserve(Container& c, std::size_t n){
+        if (n) c.reserve(n);
+    }
+
+    template <typename Container>
+    typename std::enable_if<!has_reserve<Container>::value>::type reserve(Container&, std::size_t){ }
+
+    /*
+     * sequential materialization. The container is reserved once with the length
+     * of the chain: the exact one when known, the upper bound otherwise.
+     * Chains are moved into it a block at a time.
+     */
+    template <typename Container, typename C>
+    typename std::enable_if<is_block_chain<C>::value, Container>::type
+    collect_sequential(C& c){
+        Container res;
+        reserve(res, size_hint(c));
+        auto out = std::inserter(res, res.end());
+        for_each_block(c, [&](chain_value_t<C>* block, std::size_t m){
+            out = std::move(block, block + m, out);
+        });
+        return res;
+    }
+
+    template <typename Container, typename C>
+    typename std::enable_if<!is_block_chain<C>::value, Container>::type
+    collect_sequential(C& c){
+        Container res;
+        reserve(res, size_hint(c));
+        std::copy(c.begin(), c.end(), std::inserter(res, res.end()));
+        return res;
+    }
+
+    template <typename Iter>
+    struct is_demux_iterator {
+        static const bool value = false;
+    };
+
+    template <typename Value, typename Source, typename Func>
+    struct is_demux_iterator<it::DemuxIterator<Value, Source, Func>> {
+        static const bool value = true;
+    };
+
+    template <typename C>
+    struct is_demux_chain {
+        static const bool value = is_demux_iterator<chain_iterator_t<C>>::value;
+    };
+
+    // a demux expands each element of the source straight into f
+    template <typename C, typename F>
+    typename std::enable_if<is_demux_chain<C>::value>::type
+    for_each_sequential(C& c, F& f){
+        typename chain_iterator_t<C>::local_collection r;
+        auto end = c.store->end();
+        for (auto it = c.store->begin(); it != end; ++it){
+            demux_each(c.func, *it, r, f);
+        }
+    }
+
+    template <typename C, typename F>
+    typename std::enable_if<is_block_chain<C>::value && !is_demux_chain<C>::value>::type
+    for_each_sequential(C& c, F& f){
+        for_each_block(c, [&](chain_value_t<C>* block, std::size_t m){
+            for (std::size_t i = 0; i < m; ++i){
+                f(std::move(block[i]));
+            }
+        });
+    }
+
+    template <typename C, typename F>
+    typename std::enable_if<!is_block_chain<C>::value && !is_demux_chain<C>::value>::type
+    for_each_sequential(C& c, F& f){
+        for (auto it = c.begin(); it != c.end(); ++it){
+            f(*it);
+        }
+    }
+
+    /*
+     * moves the elements of every part into a single vector, keeping the order.
+     * An exclusive prefix sum of the part sizes gives the output offset of each part,
+     * then the parts are moved concurrently.
+     */
+    template <typename T>
+    std::vector<T> concat_parts(std::vector<std::vector<T>>& parts){
+
+        std::vector<std::size_t> offset(parts.size() +1, 0);
+        for (std::size_t p = 0; p < parts.size(); ++p){
+            offset[p+1] = offset[p] + parts[p].size();
+        }
+
+        std::vector<T> res(offset[parts.size()]);
+        auto scatter = [&](std::size_t from, std::size_t to){
+            for (std::size_t p = from; p < to; ++p){
+                std::move(parts[p].begin(), parts[p].end(), res.begin() + offset[p]);
+            }
+        };
+        exec::parallel_for(parts.size(), scatter);
+        return res;
+    }
+
+    // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+    template <typename C>
+    typename std::enable_if<is_parallel_chain<C>::value, std::vector<chain_value_t<C>>>::type
+    collect_aux(C& c){
+
+        auto beg = c.begin();
+        std::size_t n = c.end() - beg;
+
+        std::vector<chain_value_t<C>> res(n);
+        auto body = [&](std::size_t from, std::size_t to){
+            auto it = beg + from;
+            for (std::size_t i = from; i < to; ++i, ++it){
+                res[i] = *it;
+            }
+        };
+        adaptive_chunks(n, body);
+        return res;
+    }
+
+    /*
+     * evaluates the parts of [0, n) into local buffers and concatenates them in order.
+     * fill(buffer, from, to) appends the results of the range to the buffer.
+     */
+    template <typename T, typename Fill>
+    std::vector<T> collect_parts(std::size_t n, Fill& fill){
+
+        std::vector<T> head;
+        auto probe = [&](std::size_t from, std::size_t to){
+            fill(head, from, to);
+        };
+        schedule s = cost_model<Fill>::plan(n, probe);
+
+        std::vector<std::vector<T>> parts(s.parts +1);
+        parts[0] = std::move(head);
+        auto body = [&](std::size_t p, std::size_t from, std::size_t to){
+            fill(parts[p+1], from, to);
+        };
+        run_parts(s, n, body);
+
+        if (s.parts <= 1){
+            if (parts[1].empty()) return std::move(parts[0]);
+            if (parts[0].empty()) return std::move(parts[1]);
+        }
+        return concat_parts(parts);
+    }
+
+    /*
+     * the elements of a parallel filter: the source is accessed at random, and each element
+     * is evaluated on its own. The survivors in [from, to) are handed to k in order.
+     */
+    template <typename C, typename Iter = chain_iterator_t<C>>
+    struct filter_source;
+
+    template <typename C, typename Value, typename Source, typename Func>
+    struct filter_source<C, it::FilterIterator<Value, Source, Func>> {
+
+        C& c;
+        decltype(c.store->begin()) beg;
+
+        filter_source(C& c) : c(c), beg(c.store->begin()) {}
+
+        std::size_t size(){
+            return c.store->end() - beg;
+        }
+
+        template <typename K>
+        void select(std::size_t from, std::size_t to, K& k){
+            auto it = beg + from;
+            for (; from < to; ++from, ++it){
+                Value x = *it;
+                if (c.func(x)) k(std::move(x));
+            }
+        }
+    };
+
+    // fused stages run over the innermost source, the first survivor is already known
+    template <typename C, typename Value, typename Source, typename Expr>
+    struct filter_source<C, it::FilterMapIterator<Value, Source, Expr>> {
+
+        it::FilterMapIterator<Value, Source, Expr> first;
+
+        filter_source(C& c) : first(c.begin()) {}
+
+        std::size_t size(){
+            return first.end - first.s;
+        }
+
+        template <typename K>
+        void select(std::size_t from, std::size_t to, K& k){
+            if (from == 0 && from < to){
+                k(first.current.get());
+                ++from;
+            }
+            auto it = first.s + from;
+            for (; from < to; ++from, ++it){
+                first.visit(it, [&](auto&& x){ k(std::forward<decltype(x)>(x)); return true; });
+            }
+        }
+    };
+
+    /*
+     * filter compaction in three steps:
+     *  - each part evaluates the predicate and keeps its survivors in a local buffer
+     *  - the survivors of all parts are concatenated in order
+     */
+    template <typename C>
+    typename std::enable_if<is_parallel_filter<C>::value, std::vector<chain_value_t<C>>>::type
+    collect_aux(C& c){
+
+        using value_type = chain_value_t<C>;
+
+        filter_source<C> src(c);
+
+        auto select = [&](std::vector<value_type>& survivors, std::size_t from, std::size_t to){
+            auto keep = [&](auto&& x){ survivors.push_back(std::forward<decltype(x)>(x)); };
+            src.select(from, to, keep);
+        };
+        return collect_parts<value_type>(src.size(), select);
+    }
+
+    /*
+     * demux expansion: each part appends the collections produced by its elements
+     * to a local buffer, the buffers are concatenated in order afterwards.
+     */
+    template <typename C>
+    typename std::enable_if<is_parallel_demux<C>::value, std::vector<chain_value_t<C>>>::type
+    collect_aux(C& c){
+
+        using value_type = chain_value_t<C>;
+
+        auto beg = c.store->begin();
+        std::size_t n = c.store->end() - beg;
+        auto& f = c.func;
+
+        auto expand = [&](std::vector<value_type>& produced, std::size_t from, std::size_t to){
+            typename chain_iterator_t<C>::local_collection buffer;
+            auto it = beg + from;
+            for (; from < to; ++from, ++it){
+                demux_append(f, *it, buffer, produced);
+            }
+        };
+        return collect_parts<value_type>(n, expand);
+    }
+
+    template <typename C>
+    typename std::enable_if<is_sequential_chain<C>::value, std::vector<chain_value_t<C>>>::type
+    collect_aux(C& c){
+        return collect_sequential<std::vector<chain_value_t<C>>>(c);
+    }
+
+    template <typename C, typename F>
+    typename std::enable_if<is_parallel_chain<C>::value>::type
+    for_each_aux(C& c, F& f){
+
+        auto beg = c.begin();
+        std::size_t n = c.end() - beg;
+
+        auto body = [&](std::size_t from, std::size_t to){
+            auto it = beg + from;
+            for (std::size_t i = from; i < to; ++i, ++it){
+                f(*it);
+            }
+        };
+        adaptive_chunks(n, body);
+    }
+
+    template <typename C, typename F>
+    typename std::enable_if<is_parallel_filter<C>::value>::type
+    for_each_aux(C& c, F& f){
+
+        filter_source<C> src(c);
+
+        auto body = [&](std::size_t from, std::size_t to){
+            auto call = [&](auto&& x){
+                chain_value_t<C> v = std::forward<decltype(x)>(x);
+                f(v);
+            };
+            src.select(from, to, call);
+        };
+        adaptive_chunks(src.size(), body);
+    }
+
+    template <typename C, typename F>
+    typename std::enable_if<is_parallel_demux<C>::value>::type
+    for_each_aux(C& c, F& f){
+
+        auto beg = c.store->begin();
+        std::size_t n = c.store->end() - beg;
+        auto& expand = c.func;
+
+        // emitting functors reuse one buffer per part
+        auto body = [&](std::size_t from, std::size_t to){
+            typename chain_iterator_t<C>::local_collection r;
+            auto it = beg + from;
+            for (std::size_t i = from; i < to; ++i, ++it){
+                demux_each(expand, *it, r, f);
+            }
+        };
+        adaptive_chunks(n, body);
+    }
+
+    template <typename C, typename F>
+    typename std::enable_if<is_sequential_chain<C>::value>::type
+    for_each_aux(C& c, F& f){
+        for_each_sequential(c, f);
+    }
+
+    // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+    // collect returns a vector unless told otherwise
+    template <typename Container, typename C>
+    struct collect_result {
+        using type = Container;
+    };
+
+    template <typename C>
+    struct collect_result<void, C> {
+        using type = std::vector<chain_value_t<C>>;
+    };
+
+    template <typename Container, typename C>
+    using collect_result_t = typename collect_result<Container, typename std::decay<C>::type>::type;
+
+    template <typename Container, typename T>
+    typename std::enable_if<std::is_same<Container, std::vector<T>>::value, Container>::type
+    move_into(std::vector<T>& v){
+        return std::move(v);
+    }
+
+    template <typename Container, typename T>
+    typename std::enable_if<!std::is_same<Container, std::vector<T>>::value, Container>::type
+    move_into(std::vector<T>& v){
+        return Container(std::make_move_iterator(v.begin()), std::make_move_iterator(v.end()));
+    }
+
+    template <typename Container, typename C>
+    Container collect_with(const sequenced_policy&, C& c){
+        return collect_sequential<Container>(c);
+    }
+
+    template <typename Container, typename P, typename C, typename = typename std::enable_if<is_parallel_policy<P>::value>::type>
+    Container collect_with(const P&, C& c){
+        auto res = collect_aux(c);
+        return move_into<Container>(res);
+    }
+
+    template <typename C, typename F>
+    void for_each_with(const sequenced_policy&, C& c, F& f){
+        for_each_sequential(c, f);
+    }
+
+    template <typename P, typename C, typename F, typename = typename std::enable_if<is_parallel_policy<P>::value>::type>
+    void for_each_with(const P&, C& c, F& f){
+        for_each_aux(c, f);
+    }
+
+} // detail namespace
+
+    /*
+     * evaluates the whole chain following its execution policy, and returns a vector
+     * (or the given container) with the results. Under a parallel policy the chain
+     * is split whenever its iterators allow it, otherwise is evaluated sequentially.
+     * The container is allocated once, using the length of the chain when known.
+     */
+    template <typename Container = void, typename C>
+    detail::collect_result_t<Container, C> collect(C& c){
+        return detail::collect_with<detail::collect_result_t<Container, C>>(detail::policy_of_t<C>(), c);
+    }
+
+    template <typename Container = void, typename C>
+    detail::collect_result_t<Container, C> collect(C&& c){
+        return detail::collect_with<detail::collect_result_t<Container, C>>(detail::policy_of_t<C>(), c);
+    }
+
+    // the given policy overrides the one of the chain
+    template <typename Container = void, typename P, typename C, typename = detail::enable_if_policy_t<P>>
+    detail::collect_result_t<Container, C> collect(const P& p, C& c){
+        return detail::collect_with<detail::collect_result_t<Container, C>>(p, c);
+    }
+
+    template <typename Container = void, typename P, typename C, typename = detail::enable_if_policy_t<P>>
+    detail::collect_result_t<Container, C> collect(const P& p, C&& c){
+        return detail::collect_with<detail::collect_result_t<Container, C>>(p, c);
+    }
+
+    /*
+     * calls f for each element in the chain, following its execution policy.
+     * Under a parallel policy f may be called concurrently and in no particular order.
+     */
+    template <typename C, typename F>
+    void for_each(C& c, F f){
+        detail::for_each_with(detail::policy_of_t<C>(), c, f);
+    }
+
+    template <typename C, typename F>
+    void for_each(C&& c, F f){
+        detail::for_each_with(detail::policy_of_t<C>(), c, f);
+    }
+
+    template <typename P, typename C, typename F, typename = detail::enable_if_policy_t<P>>
+    void for_each(const P& p, C& c, F f){
+        detail::for_each_with(p, c, f);
+    }
+
+    template <typename P, typename C, typename F, typename = detail::enable_if_policy_t<P>>
+    void for_each(const P& p, C&& c, F f){
+        detail::for_each_with(p, c, f);
+    }
+
+    /*
+     * evaluates the whole chain and returns a vector with the results.
+     * If the chain provides parallel iterators the work is split in chunks
+     * and evaluated concurrently, otherwise is evaluated sequentially.
+     */
+    template <typename C>
+    std::vector<detail::chain_value_t<C>> parallel_collect(C& c){
+        return detail::collect_aux(c);
+    }
+
+    template <typename C>
+    std::vector<detail::chain_value_t<C>> parallel_collect(C&& c){
+        return detail::collect_aux(c);
+    }
+
+    /*
+     * calls f for each element in the chain. Be aware that when evaluated in
+     * parallel f is called concurrently and in no particular order.
+     */
+    template <typename C, typename F>
+    void parallel_for_each(C& c, F f){
+        detail::for_each_aux(c, f);
+    }
+
+    template <typename C, typename F>
+    void parallel_for_each(C&& c, F f){
+        detail::for_each_aux(c, f);
+    }
+}
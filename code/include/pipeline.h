@@ -0,0 +1,854 @@
+/**
+	FunctionalCpp,  A header only library for chainable functional operations
+	in C++ collections
+    Copyright (C) 2016 Luis F. Ayuso & Stefan Moosbrugger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <iterator>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <exception>
+#include <cassert>
+
+#include "detail/utils.h"
+#include "detail/iterators.h"
+#include "detail/chaineable.h"
+#include "detail/stages.h"
+
+namespace func{
+namespace detail{
+
+    /*
+     * bounded lock-free single producer / single consumer ring.
+     * Capacity is rounded up to a power of two.
+     */
+    template <typename T>
+    class spsc_queue{
+
+        std::vector<T> buffer;
+        std::size_t mask;
+
+        // producer and consumer positions live in different cache lines
+        char pad0[64];
+        std::atomic<std::size_t> head;   // next slot to read, written by the consumer
+        char pad1[64];
+        std::atomic<std::size_t> tail;   // next slot to write, written by the producer
+        char pad2[64];
+
+    public:
+
+        explicit spsc_queue(std::size_t capacity)
+        : head(0), tail(0) {
+            std::size_t size = 1;
+            while (size < capacity) size *= 2;
+            buffer.resize(size);
+            mask = size -1;
+        }
+
+        spsc_queue(const spsc_queue&) = delete;
+        spsc_queue& operator= (const spsc_queue&) = delete;
+
+        bool try_push(T& v){
+            std::size_t t = tail.load(std::memory_order_relaxed);
+            if (t - head.load(std::memory_order_acquire) == buffer.size()) return false;
+            buffer[t & mask] = std::move(v);
+            tail.store(t+1, std::memory_order_release);
+            return true;
+        }
+
+        bool try_pop(T& v){
+            std::size_t h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire)) return false;
+            v = std::move(buffer[h & mask]);
+            head.store(h+1, std::memory_order_release);
+            return true;
+        }
+
+        // only meaningful for the consumer
+        bool empty() const{
+            return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_acquire);
+        }
+
+        // only meaningful for the producer
+        bool full() const{
+            return tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire) == buffer.size();
+        }
+    };
+
+    // shared by all the stages of a pipeline
+    struct pipeline_control{
+
+        std::atomic<bool> cancelled;
+        std::exception_ptr error;
+        std::mutex error_lock;
+
+        pipeline_control() : cancelled(false) {}
+
+        void fail(std::exception_ptr e){
+            {
+                std::lock_guard<std::mutex> guard(error_lock);
+                if (!error) error = e;
+            }
+            cancelled = true;
+        }
+
+        void rethrow(){
+            std::lock_guard<std::mutex> guard(error_lock);
+            if (error) std::rethrow_exception(error);
+        }
+    };
+
+    // batch tagged with its position in the stream, used to restore the order
+    // after a replicated stage
+    template <typename T>
+    struct sequenced_batch{
+        std::size_t seq;
+        std::vector<T> items;
+    };
+
+    /*
+     * batches of elements flowing from one stage to the next one. A side which can not
+     * move spins for a while and then sleeps until the other side moves: the queue stays
+     * lock-free while both sides keep up, and a stage waiting on a slow one does not
+     * take a core from the rest.
+     */
+    template <typename T, typename Batch = std::vector<T>>
+    class channel{
+
+        static const unsigned spin_limit = 64;
+
+        spsc_queue<Batch> queue;
+        std::atomic<bool> closed;
+        pipeline_control& control;
+
+        std::mutex lock;
+        std::condition_variable wakeup;
+        std::atomic<unsigned> sleepers;
+
+        // sleeps until ready() holds. Cancellation does not wake the sleepers, it is checked
+        // every few milliseconds
+        template <typename Ready>
+        void park(Ready ready){
+            std::unique_lock<std::mutex> guard(lock);
+            sleepers.fetch_add(1);
+            // pairs with notify(): either the other side sees a sleeper, or we see it moved
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while (!ready() && !control.cancelled){
+                wakeup.wait_for(guard, std::chrono::milliseconds(5));
+            }
+            sleepers.fetch_sub(1);
+        }
+
+        void notify(){
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (sleepers.load(std::memory_order_relaxed) == 0) return;
+            std::lock_guard<std::mutex> guard(lock);
+            wakeup.notify_all();
+        }
+
+    public:
+
+        channel(pipeline_control& control, std::size_t capacity)
+        : queue(capacity), closed(false), control(control), sleepers(0) {}
+
+        // false if the pipeline was cancelled, the batch is then dropped
+        bool push(Batch& batch){
+            for (unsigned spins = 0; !queue.try_push(batch); ++spins){
+                if (control.cancelled) return false;
+                if (spins < spin_limit) std::this_thread::yield();
+                else park([this](){ return !queue.full(); });
+            }
+            notify();
+            return true;
+        }
+
+        // false once the producer is done and everything was consumed, or if cancelled
+        bool pop(Batch& batch){
+            for (unsigned spins = 0; !queue.try_pop(batch); ++spins){
+                if (control.cancelled) return false;
+                if (closed.load(std::memory_order_acquire)) return queue.try_pop(batch);
+                if (spins < spin_limit) std::this_thread::yield();
+                else park([this](){ return !queue.empty() || closed.load(std::memory_order_acquire); });
+            }
+            notify();
+            return true;
+        }
+
+        bool try_push(Batch& batch){
+            if (!queue.try_push(batch)) return false;
+            notify();
+            return true;
+        }
+
+        bool try_pop(Batch& batch){
+            if (!queue.try_pop(batch)) return false;
+            notify();
+            return true;
+        }
+
+        // the producer is done and everything was consumed
+        bool drained() const{
+            return closed.load(std::memory_order_acquire) && queue.empty();
+        }
+
+        void close(){
+            closed.store(true, std::memory_order_release);
+            notify();
+        }
+
+        pipeline_control& get_control(){
+            return control;
+        }
+    };
+
+    // consumer side of a channel, iterators over the channel share it
+    template <typename T>
+    class channel_reader{
+
+        channel<T>& chan;
+        std::vector<T> batch;
+        std::size_t pos;
+        bool primed, done;
+
+        void fetch(){
+            batch.clear();
+            pos = 0;
+            while (batch.empty()){
+                if (!chan.pop(batch)){
+                    done = true;
+                    chan.get_control().rethrow();
+                    return;
+                }
+            }
+        }
+
+    public:
+
+        explicit channel_reader(channel<T>& chan)
+        : chan(chan), pos(0), primed(false), done(false) {}
+
+        void prime(){
+            if (primed) return;
+            primed = true;
+            fetch();
+        }
+
+        bool finished() const{
+            return done;
+        }
+
+        const T& current() const{
+            assert(!done && "deref and end iterator");
+            return batch[pos];
+        }
+
+        void next(){
+            assert(!done && "move and end iterator");
+            if (++pos == batch.size()) fetch();
+        }
+    };
+
+} // detail namespace
+
+namespace it{
+
+    /*
+     * input iterator reading from a pipeline channel. All the copies
+     * share the position in the channel, as it happens with stream iterators.
+     */
+    template <typename Value>
+    struct ChannelIterator : public detail::iterator_type<ChannelIterator<Value>, Value> {
+
+        detail::channel_reader<Value>* reader;
+
+        using self_type = ChannelIterator<Value>;
+
+        // returned by the postfix increment, keeps the value it was pointing to
+        struct postfix_proxy{
+            Value v;
+            const Value& operator* () const { return v; }
+            const Value* operator-> () const { return &v; }
+        };
+
+        ChannelIterator()
+        : reader(nullptr) {}
+
+        explicit ChannelIterator(detail::channel_reader<Value>* reader)
+        : reader(reader) {
+            reader->prime();
+        }
+
+        bool at_end() const{
+            return !reader || reader->finished();
+        }
+
+        bool operator == (const ChannelIterator& o) const{
+            return at_end() == o.at_end();
+        }
+
+        bool operator != (const ChannelIterator& o) const{
+            return !(*this == o);
+        }
+
+        const Value& operator* () const{
+            return reader->current();
+        }
+
+        const Value* operator-> () const{
+            return &reader->current();
+        }
+
+        self_type& operator++(){
+            reader->next();
+            return *this;
+        }
+
+        postfix_proxy operator++(int){
+            postfix_proxy cpy { reader->current() };
+            reader->next();
+            return cpy;
+        }
+    };
+
+} // it namespace
+
+namespace detail{
+
+    // stages which can be fed from a channel instead of their original source
+    template <typename Iter, typename NewSource>
+    struct rebind_source{
+        static const bool value = false;
+    };
+
+    // a fused transform runs only its outermost functor, the nested ones are stages of their own
+    template <typename V, typename S, typename F, typename NewSource>
+    struct rebind_source<it::TransformIterator<V,S,F>, NewSource>{
+        static const bool value = true;
+        using type = it::TransformIterator<V,NewSource,typename outer_fn<F>::type>;
+    };
+
+    template <typename V, typename S, typename F, typename NewSource>
+    struct rebind_source<it::FilterIterator<V,S,F>, NewSource>{
+        static const bool value = true;
+        using type = it::FilterIterator<V,NewSource,F>;
+    };
+
+    // a fused filter_map runs only its outermost filter or transform
+    template <typename V, typename S, typename P, typename E, typename NewSource>
+    struct rebind_source<it::FilterMapIterator<V,S,kept<P,E>>, NewSource>{
+        static const bool value = true;
+        using type = it::FilterIterator<V,NewSource,P>;
+    };
+
+    template <typename V, typename S, typename F, typename E, typename NewSource>
+    struct rebind_source<it::FilterMapIterator<V,S,mapped<F,E>>, NewSource>{
+        static const bool value = true;
+        using type = it::TransformIterator<V,NewSource,F>;
+    };
+
+    template <typename V, typename S, typename F, typename NewSource>
+    struct rebind_source<it::DemuxIterator<V,S,F>, NewSource>{
+        static const bool value = true;
+        using type = it::DemuxIterator<V,NewSource,F>;
+    };
+
+    // mux functors work with the source iterators, it can be only split when
+    // the functor accepts channel iterators as well (i.e. generic lambdas)
+    template <typename F, typename It, typename = void>
+    struct accepts_iterators{
+        static const bool value = false;
+    };
+
+    template <typename F, typename It>
+    struct accepts_iterators<F, It, decltype((void) std::declval<F&>()(std::declval<It&>(), std::declval<const It&>()))>{
+        static const bool value = true;
+    };
+
+    template <typename V, typename S, typename F, typename NewSource>
+    struct rebind_source<it::MuxIterator<V,S,F>, NewSource>{
+        static const bool value = accepts_iterators<F, NewSource>::value;
+        using type = it::MuxIterator<V,NewSource,F>;
+    };
+
+    template <typename Iter>
+    struct is_transform_iterator{
+        static const bool value = false;
+    };
+
+    template <typename V, typename S, typename F>
+    struct is_transform_iterator<it::TransformIterator<V,S,F>>{
+        static const bool value = true;
+    };
+
+    template <typename V, typename S, typename F, typename E>
+    struct is_transform_iterator<it::FilterMapIterator<V,S,mapped<F,E>>>{
+        static const bool value = true;
+    };
+
+    template <typename C>
+    struct is_chaineable{
+        static const bool value = false;
+    };
+
+    template <typename F, typename C, typename S, typename V, typename I, typename P>
+    struct is_chaineable<chaineable_t<F,C,S,V,I,P>>{
+        static const bool value = true;
+    };
+
+    template <typename C>
+    using pipeline_value_t = typename std::iterator_traits<decltype(std::declval<C&>().begin())>::value_type;
+
+} // detail namespace
+
+    /*
+     * marks a transform to be replicated when the chain is pipelined: the batches are
+     * distributed among n workers and put back in order before the next stage.
+     * The transform functor is called concurrently, it must not have state.
+     * Outside of a pipeline it behaves as the transform it wraps.
+     */
+    template <typename Storage>
+    struct replicate_t{
+
+        using chain_type = typename Storage::stored_type;
+        using value_type = typename chain_type::value_type;
+        using iterator = typename chain_type::iterator;
+        using policy_type = detail::policy_of_t<chain_type>;
+
+        Storage store;
+        const unsigned replicas;
+
+        replicate_t(unsigned replicas, Storage&& store)
+        : store(std::move(store)), replicas(replicas) {
+            static_assert(detail::is_transform_iterator<iterator>::value, "only transform stages can be replicated");
+        }
+
+        replicate_t(replicate_t&& o)
+        : store(std::move(o.store)), replicas(o.replicas) {}
+
+        replicate_t(const replicate_t&) = delete;
+
+        template <typename C = chain_type, typename = typename std::enable_if<detail::has_size<C>::value>::type>
+        std::size_t size(){
+            return store->size();
+        }
+
+        std::size_t size_hint(){
+            return detail::size_hint(*store);
+        }
+
+        iterator begin(){
+            return store->begin();
+        }
+
+        iterator end(){
+            return store->end();
+        }
+    };
+
+    // lvalue chain
+    template <typename C>
+    replicate_t<detail::ref_t<C>> replicate(unsigned n, C& c){
+        return replicate_t<detail::ref_t<C>>(n, detail::ref_t<C>(c));
+    }
+
+    // rvalue chain
+    template <typename C>
+    replicate_t<detail::val_t<C>> replicate(unsigned n, C&& c){
+        return replicate_t<detail::val_t<C>>(n, detail::val_t<C>(std::move(c)));
+    }
+
+namespace detail{
+
+    template <typename C>
+    struct is_replicate{
+        static const bool value = false;
+    };
+
+    template <typename S>
+    struct is_replicate<replicate_t<S>>{
+        static const bool value = true;
+    };
+
+    // collections which are evaluated as stages of their own
+    template <typename C>
+    struct is_pipeline_stage{
+        static const bool value = is_chaineable<C>::value || is_replicate<C>::value;
+    };
+
+    // a stage boundary exists between a chaineable and the stage it consumes
+    template <typename C, typename = void>
+    struct is_stage_boundary{
+        static const bool value = false;
+    };
+
+    template <typename C>
+    struct is_stage_boundary<C, typename std::enable_if<is_chaineable<C>::value>::type>{
+        using inner_type = typename C::storage_t::stored_type;
+        static const bool value = is_pipeline_stage<inner_type>::value &&
+                rebind_source<typename C::iterator, it::ChannelIterator<pipeline_value_t<inner_type>>>::value;
+    };
+
+    // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+    struct link_base{
+        virtual ~link_base() {}
+    };
+
+    template <typename T>
+    struct link : public link_base{
+        channel<T> chan;
+        channel_reader<T> reader;
+
+        link(pipeline_control& control, std::size_t capacity)
+        : chan(control, capacity), reader(chan) {}
+    };
+
+    template <typename T, typename Batch>
+    struct channel_link : public link_base{
+        channel<T, Batch> chan;
+
+        channel_link(pipeline_control& control, std::size_t capacity)
+        : chan(control, capacity) {}
+    };
+
+    // the running pipeline: threads and channels between them
+    struct pipeline_state{
+
+        pipeline_control control;
+        std::vector<std::unique_ptr<link_base>> links;
+        std::vector<std::thread> threads;
+        const std::size_t batch_size, capacity;
+
+        pipeline_state(std::size_t batch_size, std::size_t capacity)
+        : batch_size(batch_size), capacity(capacity) {}
+
+        ~pipeline_state(){
+            control.cancelled = true;
+            for (auto& t : threads) t.join();
+        }
+
+        template <typename T>
+        link<T>& make_link(){
+            link<T>* l = new link<T>(control, capacity);
+            links.emplace_back(l);
+            return *l;
+        }
+
+        template <typename T, typename Batch>
+        channel<T, Batch>& make_channel(){
+            channel_link<T, Batch>* l = new channel_link<T, Batch>(control, capacity);
+            links.emplace_back(l);
+            return l->chan;
+        }
+
+        template <typename F>
+        void spawn(F f){
+            threads.emplace_back([this, f]() mutable {
+                try{
+                    f();
+                }catch(...){
+                    control.fail(std::current_exception());
+                }
+            });
+        }
+
+        // evaluates [it, end) and sends the results in batches
+        template <typename It, typename T>
+        void produce(It it, It end, channel<T>& out){
+            std::vector<T> batch;
+            batch.reserve(batch_size);
+            for (; it != end; ++it){
+                batch.push_back(*it);
+                if (batch.size() == batch_size){
+                    if (!out.push(batch)) break;
+                    batch.clear();
+                    batch.reserve(batch_size);
+                }
+            }
+            if (!batch.empty()) out.push(batch);
+            out.close();
+        }
+    };
+
+    // the innermost stage evaluates the remaining chain as a whole
+    template <typename C, typename = void>
+    struct stage{
+
+        static constexpr unsigned count(){
+            return 1;
+        }
+
+        static void start(C& c, channel<pipeline_value_t<C>>& out, pipeline_state& st){
+            st.spawn([&c, &out, &st]() {
+                try{
+                    st.produce(c.begin(), c.end(), out);
+                }catch(...){
+                    out.close();
+                    throw;
+                }
+            });
+        }
+    };
+
+    // the stage reads from the channel fed by the chaineable it consumes
+    template <typename C>
+    struct stage<C, typename std::enable_if<is_stage_boundary<C>::value>::type>{
+
+        using inner_type = typename C::storage_t::stored_type;
+        using inner_value = pipeline_value_t<inner_type>;
+        using source_iterator = it::ChannelIterator<inner_value>;
+        using iterator = typename rebind_source<typename C::iterator, source_iterator>::type;
+
+        static constexpr unsigned count(){
+            return 1 + stage<inner_type>::count();
+        }
+
+        static void start(C& c, channel<pipeline_value_t<C>>& out, pipeline_state& st){
+
+            link<inner_value>& in = st.make_link<inner_value>();
+            stage<inner_type>::start(*c.store, in.chan, st);
+
+            st.spawn([&c, &in, &out, &st]() {
+                try{
+                    iterator beg(c.func, source_iterator(&in.reader), source_iterator());
+                    iterator end(c.func, source_iterator(), source_iterator());
+                    st.produce(beg, end, out);
+                }catch(...){
+                    out.close();
+                    throw;
+                }
+            });
+        }
+    };
+
+    /*
+     * replicated transform, a farm of workers:
+     *  - a dispatcher cuts the input in numbered batches and hands them round-robin: batch
+     *    k goes to worker k % n.
+     *  - each worker applies the transform to its batches, in the order they came.
+     *  - a collector takes batch k from worker k % n and sends it downstream. The order is
+     *    restored without a reorder buffer: a slow batch stops the other workers once their
+     *    channels are full, the memory in flight is bounded by n channels.
+     */
+    template <typename S>
+    struct stage<replicate_t<S>>{
+
+        using chain_type = typename S::stored_type;
+        using inner_type = typename chain_type::storage_t::stored_type;
+        using inner_value = pipeline_value_t<inner_type>;
+        using value_type = pipeline_value_t<chain_type>;
+
+        using in_batch = sequenced_batch<inner_value>;
+        using out_batch = sequenced_batch<value_type>;
+        using in_channel = channel<inner_value, in_batch>;
+        using out_channel = channel<value_type, out_batch>;
+
+        using worker_iterator = typename rebind_source<typename chain_type::iterator, typename std::vector<inner_value>::iterator>::type;
+
+        static constexpr unsigned count(){
+            return 1 + (is_pipeline_stage<inner_type>::value? stage<inner_type>::count(): 0);
+        }
+
+        static void start(replicate_t<S>& r, channel<value_type>& out, pipeline_state& st){
+
+            chain_type& c = *r.store;
+            const unsigned n = std::max(r.replicas, 1u);
+
+            std::vector<in_channel*> to_workers;
+            std::vector<out_channel*> from_workers;
+            for (unsigned i = 0; i < n; ++i){
+                to_workers.push_back(&st.make_channel<inner_value, in_batch>());
+                from_workers.push_back(&st.make_channel<value_type, out_batch>());
+            }
+
+            start_dispatcher(*c.store, to_workers, st, std::integral_constant<bool, is_pipeline_stage<inner_type>::value>());
+
+            for (unsigned i = 0; i < n; ++i){
+                in_channel& in = *to_workers[i];
+                out_channel& res = *from_workers[i];
+                st.spawn([&c, &in, &res]() {
+                    try{
+                        in_batch b;
+                        while (in.pop(b)){
+                            worker_iterator beg(c.func, b.items.begin(), b.items.end());
+                            worker_iterator end(c.func, b.items.end(), b.items.end());
+                            out_batch o { b.seq, std::vector<value_type>() };
+                            o.items.reserve(b.items.size());
+                            for (; beg != end; ++beg){
+                                o.items.push_back(*beg);
+                            }
+                            if (!res.push(o)) break;
+                        }
+                    }catch(...){
+                        res.close();
+                        throw;
+                    }
+                    res.close();
+                });
+            }
+
+            st.spawn([from_workers, &out]() {
+                try{
+                    collect(from_workers, out);
+                }catch(...){
+                    out.close();
+                    throw;
+                }
+                out.close();
+            });
+        }
+
+    private:
+
+        template <typename Inner>
+        static void start_dispatcher(Inner& inner, std::vector<in_channel*> to_workers, pipeline_state& st, std::true_type){
+            link<inner_value>& in = st.make_link<inner_value>();
+            stage<Inner>::start(inner, in.chan, st);
+            st.spawn([&in, to_workers, &st]() {
+                dispatch(it::ChannelIterator<inner_value>(&in.reader), it::ChannelIterator<inner_value>(), to_workers, st);
+            });
+        }
+
+        template <typename Inner>
+        static void start_dispatcher(Inner& inner, std::vector<in_channel*> to_workers, pipeline_state& st, std::false_type){
+            st.spawn([&inner, to_workers, &st]() {
+                dispatch(inner.begin(), inner.end(), to_workers, st);
+            });
+        }
+
+        template <typename It>
+        static void dispatch(It it, It end, const std::vector<in_channel*>& to_workers, pipeline_state& st){
+
+            const std::size_t n = to_workers.size();
+
+            // the worker of a batch is given by its number
+            auto send = [&](in_batch& b) -> bool {
+                return to_workers[b.seq % n]->push(b);
+            };
+
+            try{
+                in_batch b { 0, std::vector<inner_value>() };
+                b.items.reserve(st.batch_size);
+                bool alive = true;
+                for (; alive && it != end; ++it){
+                    b.items.push_back(*it);
+                    if (b.items.size() == st.batch_size){
+                        std::size_t seq = b.seq;
+                        alive = send(b);
+                        b = in_batch { seq+1, std::vector<inner_value>() };
+                        b.items.reserve(st.batch_size);
+                    }
+                }
+                if (alive && !b.items.empty()) send(b);
+            }catch(...){
+                for (auto w : to_workers) w->close();
+                throw;
+            }
+            for (auto w : to_workers) w->close();
+        }
+
+        static void collect(const std::vector<out_channel*>& from_workers, channel<value_type>& out){
+
+            // batches were handed round-robin, the stream ends at the first worker without the next one
+            const std::size_t n = from_workers.size();
+            out_batch b;
+            for (std::size_t next = 0; from_workers[next % n]->pop(b); ++next){
+                assert(b.seq == next && "batches out of order");
+                if (!out.push(b.items)) return;
+            }
+        }
+    };
+
+} // detail namespace
+
+    /*
+     * Pipelined evaluation of a chain: each operator (transform, filter, mux, demux)
+     * runs in its own thread and sends its results in batches to the next one through
+     * a bounded lock-free queue. The innermost operator reads the original collection.
+     *
+     * The pipeline is an input collection, it can be iterated once. Threads are started
+     * by begin() and stopped when the pipeline is destroyed, even if the results were
+     * not consumed. An exception thrown in any stage is rethrown to the consumer.
+     */
+    template <typename Storage>
+    struct pipeline_t{
+
+        using chain_type = typename Storage::stored_type;
+        using value_type = detail::pipeline_value_t<chain_type>;
+        using iterator = it::ChannelIterator<value_type>;
+
+        static const std::size_t default_batch_size = 256;
+        static const std::size_t default_capacity = 8;
+
+    private:
+
+        struct state{
+            Storage store;
+            // destroyed before the chain, it joins the threads
+            detail::pipeline_state run;
+            detail::link<value_type>* out;
+
+            state(Storage&& store, std::size_t batch_size, std::size_t capacity)
+            : store(std::move(store)), run(batch_size, capacity), out(nullptr) {}
+        };
+        std::unique_ptr<state> st;
+
+    public:
+
+        pipeline_t(Storage&& store, std::size_t batch_size = default_batch_size, std::size_t capacity = default_capacity)
+        : st(new state(std::move(store), batch_size, capacity)) {}
+
+        pipeline_t(pipeline_t&& o) = default;
+        pipeline_t(const pipeline_t&) = delete;
+        pipeline_t& operator= (const pipeline_t&) = delete;
+
+        iterator begin(){
+            if (!st->out){
+                st->out = &st->run.template make_link<value_type>();
+                detail::stage<chain_type>::start(*st->store, st->out->chan, st->run);
+            }
+            return iterator(&st->out->reader);
+        }
+
+        iterator end(){
+            return iterator();
+        }
+
+        // number of stages the chain is split into, a replicated stage counts as one
+        static constexpr unsigned stages(){
+            return detail::stage<chain_type>::count();
+        }
+    };
+
+    // lvalue chain, it must outlive the pipeline
+    template <typename C>
+    pipeline_t<detail::ref_t<C>> pipeline(C& c, std::size_t batch_size = pipeline_t<detail::ref_t<C>>::default_batch_size){
+        return pipeline_t<detail::ref_t<C>>(detail::ref_t<C>(c), batch_size);
+    }
+
+    // rvalue chain, the pipeline takes ownership
+    template <typename C>
+    pipeline_t<detail::val_t<C>> pipeline(C&& c, std::size_t batch_size = pipeline_t<detail::val_t<C>>::default_batch_size){
+        return pipeline_t<detail::val_t<C>>(detail::val_t<C>(std::move(c)), batch_size);
+    }
+}
@@ -0,0 +1,108 @@
+/**
+	FunctionalCpp,  A header only library for chainable functional operations
+	in C++ collections
+    Copyright (C) 2016 Luis F. Ayuso & Stefan Moosbrugger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <type_traits>
+
+namespace func{
+
+    // execution policy tags, to be passed as first argument of the operations.
+    // A chain built with a policy keeps it, and the operations chained on top
+    // of it inherit it. Terminal operations (collect, for_each, reduce) use the
+    // policy of the chain they evaluate.
+
+    // evaluated in the calling thread, in order.
+    struct sequenced_policy{ };
+
+    // the chain is split among threads whenever its iterators allow it,
+    // the functors are called concurrently.
+    struct parallel_policy{ };
+
+    // as parallel, and the functors must be safe to interleave within a thread
+    // as well (no locks). The evaluation is currently the same as parallel.
+    struct parallel_unsequenced_policy{ };
+
+    constexpr sequenced_policy seq{};
+    constexpr parallel_policy par{};
+    constexpr parallel_unsequenced_policy par_unseq{};
+
+namespace detail{
+
+    template <typename T>
+    struct is_execution_policy : std::false_type { };
+
+    template <> struct is_execution_policy<sequenced_policy> : std::true_type { };
+    template <> struct is_execution_policy<parallel_policy> : std::true_type { };
+    template <> struct is_execution_policy<parallel_unsequenced_policy> : std::true_type { };
+
+    template <typename T>
+    struct is_parallel_policy : std::false_type { };
+
+    template <> struct is_parallel_policy<parallel_policy> : std::true_type { };
+    template <> struct is_parallel_policy<parallel_unsequenced_policy> : std::true_type { };
+
+    template <typename T>
+    using enable_if_policy_t = typename std::enable_if<is_execution_policy<typename std::decay<T>::type>::value>::type;
+
+    template <typename... T>
+    struct make_void {
+        using type = void;
+    };
+
+    // policy of a collection: its own for chains, sequential for anything else
+    template <typename C, typename = void>
+    struct policy_of {
+        using type = sequenced_policy;
+    };
+
+    template <typename C>
+    struct policy_of<C, typename make_void<typename C::policy_type>::type> {
+        using type = typename C::policy_type;
+    };
+
+    template <typename C>
+    using policy_of_t = typename policy_of<typename std::decay<C>::type>::type;
+
+    // policy of an operation over several chains: the most parallel one
+    // requested, parallel when parallel and unsequenced are mixed
+    template <typename... P>
+    struct common_policy;
+
+    template <>
+    struct common_policy<> {
+        using type = sequenced_policy;
+    };
+
+    template <typename P>
+    struct common_policy<P> {
+        using type = P;
+    };
+
+    template <typename A, typename B, typename... P>
+    struct common_policy<A, B, P...> {
+        using first = typename std::conditional<std::is_same<A, B>::value || std::is_same<B, sequenced_policy>::value, A,
+                      typename std::conditional<std::is_same<A, sequenced_policy>::value, B, parallel_policy>::type>::type;
+        using type = typename common_policy<first, P...>::type;
+    };
+
+    template <typename... P>
+    using common_policy_t = typename common_policy<P...>::type;
+
+} // detail namespace
+} // func namespace
@@ -21,23 +21,105 @@
 #define functional_reduce_h
 
 #include <functional>
+#include <deque>
 #include "detail/utils.h"
+#include "policy.h"
+#include "parallel.h"
 
 namespace func{
 namespace {
 
-    template <typename N, typename R, typename C>
-    N reduce_aux(std::function<R (R, N)>& f, C& c, R def){
-        auto it = c.begin();
-        if (it != c.end()){
-            R value = def;
-            while (it != c.end()){
+    // generic over the functor, so it can be inlined in the loop
+    template <typename F, typename R, typename C>
+    typename std::enable_if<!detail::is_block_chain<C>::value, R>::type
+    reduce_aux(F& f, C& c, R value){
+        auto end = c.end();
+        for (auto it = c.begin(); it != end; ++it){
+            value = f(value, *it);
+        }
+        return value;
+    }
+
+    // chains are folded a block at a time
+    template <typename F, typename R, typename C>
+    typename std::enable_if<detail::is_block_chain<C>::value, R>::type
+    reduce_aux(F& f, C& c, R value){
+        detail::for_each_block(c, [&](detail::chain_value_t<C>* block, std::size_t m){
+            for (std::size_t i = 0; i < m; ++i){
+                value = f(value, std::move(block[i]));
+            }
+        });
+        return value;
+    }
+
+    template <typename F, typename R, typename C>
+    typename std::enable_if<!detail::is_parallel_chain<C>::value, R>::type
+    par_reduce_aux(F& f, C& c, R def){
+        return reduce_aux(f, c, def);
+    }
+
+    /*
+     * the range is split in parts, each part is folded starting by its first
+     * element and the partial results are combined pairwise in a tree.
+     * Therefore f must be associative and accept its result type as both
+     * parameters. The cost model decides how many parts are worth it.
+     */
+    template <typename F, typename R, typename C>
+    typename std::enable_if<detail::is_parallel_chain<C>::value, R>::type
+    par_reduce_aux(F& f, C& c, R def){
+
+        auto beg = c.begin();
+        std::size_t n = c.end() - beg;
+        if (n == 0) return def;
+
+        auto fold = [&](R& value, std::size_t from, std::size_t to){
+            auto it = beg + from;
+            value = *it;
+            for (++it, ++from; from < to; ++from, ++it){
                 value = f(value, *it);
-                ++it;
             }
-            return value;
+        };
+
+        R head = def;
+        auto probe = [&](std::size_t from, std::size_t to){
+            fold(head, from, to);
+        };
+        detail::schedule s = detail::cost_model<decltype(fold)>::plan(n, probe);
+
+        // not a vector, std::vector<bool> can not be written concurrently.
+        // parts can be empty after aligning their bounds
+        std::deque<R> partial(s.parts +1, def);
+        std::deque<bool> filled(s.parts +1, false);
+        partial[0] = head;
+        filled[0] = s.head > 0;
+        auto body = [&](std::size_t p, std::size_t from, std::size_t to){
+            if (from == to) return;
+            fold(partial[p+1], from, to);
+            filled[p+1] = true;
+        };
+        detail::run_parts(s, n, body);
+
+        std::deque<R> values;
+        for (std::size_t p = 0; p < partial.size(); ++p){
+            if (filled[p]) values.push_back(partial[p]);
         }
-        return def;
+
+        for (std::size_t stride = 1; stride < values.size(); stride *= 2){
+            for (std::size_t p = 0; p + stride < values.size(); p += 2*stride){
+                values[p] = f(values[p], values[p+stride]);
+            }
+        }
+        return f(def, values[0]);
+    }
+
+    template <typename F, typename R, typename C>
+    R reduce_with(const sequenced_policy&, F& f, C& c, R def){
+        return reduce_aux(f, c, def);
+    }
+
+    template <typename P, typename F, typename R, typename C, typename = typename std::enable_if<detail::is_parallel_policy<P>::value>::type>
+    R reduce_with(const P&, F& f, C& c, R def){
+        return par_reduce_aux(f, c, def);
     }
 } // anonimous namespace
 
@@ -45,32 +127,42 @@ namespace {
     // lvalue collection
     template <typename N, typename R, typename C>
     R reduce(std::function<R (R,N)> f, C& c, R def = R()){
-        return reduce_aux(f,c,def);
+        return reduce_with(detail::policy_of_t<C>(), f, c, def);
     }
 
     // for function type
     // rvalue collection
     template <typename N, typename R, typename C>
     R reduce(std::function<R (R,N)> f, C&& c, R def = R()){
-        return reduce_aux(f, c, def);
+        return reduce_with(detail::policy_of_t<C>(), f, c, def);
     }
 
     // for lambda type
     // lvalue collection
     template <typename F, typename R, typename C>
     R reduce(F f, C& c, R def){
-        using N = typename C::value_type;
-        std::function<R(R,N)> func = f;
-        return reduce_aux(func, c, def);
+        return reduce_with(detail::policy_of_t<C>(), f, c, def);
     }
 
     // for lambda type
     // xvalue collection
     template <typename F, typename R, typename C>
     R reduce(F f, C&& c, R def){
-        using N = typename C::value_type;
-        std::function<R(R,N)> func = f;
-        return reduce_aux(func, c, def);
+        return reduce_with(detail::policy_of_t<C>(), f, c, def);
+    }
+
+    // with execution policy, overrides the one of the chain
+    // lvalue collection
+    template <typename P, typename F, typename R, typename C, typename = detail::enable_if_policy_t<P>>
+    R reduce(const P& p, F f, C& c, R def){
+        return reduce_with(p, f, c, def);
+    }
+
+    // with execution policy, overrides the one of the chain
+    // xvalue collection
+    template <typename P, typename F, typename R, typename C, typename = detail::enable_if_policy_t<P>>
+    R reduce(const P& p, F f, C&& c, R def){
+        return reduce_with(p, f, c, def);
     }
 
 } // func namespace
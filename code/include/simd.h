@@ -0,0 +1,702 @@
+/**
+	FunctionalCpp,  A header only library for chainable functional operations
+	in C++ collections
+    Copyright (C) 2016 Luis F. Ayuso & Stefan Moosbrugger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include <iterator>
+#include <vector>
+#include <cstdint>
+#include <new>
+#include <cstring>
+
+#include "detail/utils.h"
+#include "detail/chaineable.h"
+
+// the kernels are compiled for each instruction set and chosen at runtime,
+// where the compiler allows it. Elsewhere (or with FUNC_SIMD_DISPATCH=0) the
+// baseline kernel is used
+#ifndef FUNC_SIMD_DISPATCH
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FUNC_SIMD_DISPATCH 1
+#else
+#define FUNC_SIMD_DISPATCH 0
+#endif
+#endif
+
+#if defined(__GNUC__)
+#define FUNC_SIMD_INLINE inline __attribute__((always_inline))
+#else
+#define FUNC_SIMD_INLINE inline
+#endif
+
+#if FUNC_SIMD_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace func{
+namespace simd{
+
+namespace detail{
+    template <std::size_t Bytes>
+    struct signed_of;
+
+    template <> struct signed_of<1> { using type = std::int8_t; };
+    template <> struct signed_of<2> { using type = std::int16_t; };
+    template <> struct signed_of<4> { using type = std::int32_t; };
+    template <> struct signed_of<8> { using type = std::int64_t; };
+
+#if FUNC_SIMD_DISPATCH
+    // vector of the compiler, only for values local to an operation: functions built
+    // for different instruction sets would pass them differently
+    template <typename T, unsigned N>
+    struct native{
+        typedef T type __attribute__((vector_size(sizeof(T)*N)));
+        // to read and write the lanes of packs in place
+        typedef T lanes __attribute__((vector_size(sizeof(T)*N), aligned(alignof(T)), may_alias));
+    };
+#endif
+}
+
+    /*
+     * N lanes of an arithmetic type. The operations are inlined in kernels built for a
+     * given instruction set, where the compiler maps them to its registers. Generic
+     * functors made of arithmetic ([](auto x){ return x*2+1; }) can be evaluated on
+     * single values and on packs alike
+     */
+    template <typename T, unsigned N>
+    struct pack{
+
+        using value_type = T;
+        static constexpr unsigned size = N;
+
+        T v[N];
+
+        static FUNC_SIMD_INLINE pack load(const T* p){
+            pack r;
+#if FUNC_SIMD_DISPATCH
+            using lanes_t = typename detail::native<T,N>::lanes;
+            *reinterpret_cast<lanes_t*>(r.v) = *reinterpret_cast<const lanes_t*>(p);
+#else
+            std::memcpy(r.v, p, sizeof(r.v));
+#endif
+            return r;
+        }
+
+        static FUNC_SIMD_INLINE pack broadcast(T x){
+            pack r;
+            for (unsigned i = 0; i < N; ++i) r.v[i] = x;
+            return r;
+        }
+
+        // converted to the type of the output
+        template <typename U>
+        FUNC_SIMD_INLINE void store(U* p) const{
+            for (unsigned i = 0; i < N; ++i) p[i] = v[i];
+        }
+
+        FUNC_SIMD_INLINE void store(T* p) const{
+#if FUNC_SIMD_DISPATCH
+            using lanes_t = typename detail::native<T,N>::lanes;
+            *reinterpret_cast<lanes_t*>(p) = *reinterpret_cast<const lanes_t*>(v);
+#else
+            std::memcpy(p, v, sizeof(v));
+#endif
+        }
+
+        T& operator[](unsigned i) { return v[i]; }
+        const T& operator[](unsigned i) const { return v[i]; }
+    };
+
+    /*
+     * result of comparing packs of T, each lane is all ones when the comparison holds.
+     * Masks are combined with & | ! and && || (which evaluate both sides), as scalar
+     * booleans are
+     */
+    template <typename T, unsigned N>
+    struct mask{
+
+        using lane_type = typename detail::signed_of<sizeof(T)>::type;
+        pack<lane_type, N> bits;
+
+        bool operator[](unsigned i) const { return bits[i] != 0; }
+    };
+
+    template <typename U>
+    using enable_if_scalar_t = typename std::enable_if<std::is_arithmetic<U>::value>::type;
+
+// R = A OP B lane by lane, A and B hold TA, R holds TR. Comparisons (SIGN -) give all ones
+#if FUNC_SIMD_DISPATCH
+#define FUNC_SIMD_LANEWISE(TR, R, TA, A, B, OP, SIGN) { \
+        using in_t = typename detail::native<TA,N>; \
+        using out_t = typename detail::native<TR,N>; \
+        *reinterpret_cast<typename out_t::lanes*>(R) = (typename out_t::type)( \
+                *reinterpret_cast<const typename in_t::lanes*>(A) OP *reinterpret_cast<const typename in_t::lanes*>(B)); \
+    }
+#else
+#define FUNC_SIMD_LANEWISE(TR, R, TA, A, B, OP, SIGN) { \
+        for (unsigned i = 0; i < N; ++i) R[i] = SIGN TR(A[i] OP B[i]); \
+    }
+#endif
+
+    // scalars are converted to the lane type
+#define FUNC_PACK_ARITHMETIC(OP) \
+    template <typename T, unsigned N> \
+    FUNC_SIMD_INLINE pack<T,N> operator OP (const pack<T,N>& a, const pack<T,N>& b){ \
+        pack<T,N> r; \
+        FUNC_SIMD_LANEWISE(T, r.v, T, a.v, b.v, OP, +) \
+        return r; \
+    } \
+    template <typename T, unsigned N, typename U, typename = enable_if_scalar_t<U>> \
+    FUNC_SIMD_INLINE pack<T,N> operator OP (const pack<T,N>& a, U b){ \
+        return a OP pack<T,N>::broadcast(static_cast<T>(b)); \
+    } \
+    template <typename T, unsigned N, typename U, typename = enable_if_scalar_t<U>> \
+    FUNC_SIMD_INLINE pack<T,N> operator OP (U a, const pack<T,N>& b){ \
+        return pack<T,N>::broadcast(static_cast<T>(a)) OP b; \
+    } \
+    template <typename T, unsigned N, typename B> \
+    FUNC_SIMD_INLINE pack<T,N>& operator OP##= (pack<T,N>& a, const B& b){ \
+        return a = a OP b; \
+    }
+
+    FUNC_PACK_ARITHMETIC(+)
+    FUNC_PACK_ARITHMETIC(-)
+    FUNC_PACK_ARITHMETIC(*)
+    FUNC_PACK_ARITHMETIC(/)
+
+#undef FUNC_PACK_ARITHMETIC
+
+    template <typename T, unsigned N>
+    FUNC_SIMD_INLINE pack<T,N> operator- (const pack<T,N>& a){
+        return T(0) - a;
+    }
+
+#define FUNC_PACK_COMPARISON(OP) \
+    template <typename T, unsigned N> \
+    FUNC_SIMD_INLINE mask<T,N> operator OP (const pack<T,N>& a, const pack<T,N>& b){ \
+        using S = typename mask<T,N>::lane_type; \
+        mask<T,N> r; \
+        FUNC_SIMD_LANEWISE(S, r.bits.v, T, a.v, b.v, OP, -) \
+        return r; \
+    } \
+    template <typename T, unsigned N, typename U, typename = enable_if_scalar_t<U>> \
+    FUNC_SIMD_INLINE mask<T,N> operator OP (const pack<T,N>& a, U b){ \
+        return a OP pack<T,N>::broadcast(static_cast<T>(b)); \
+    } \
+    template <typename T, unsigned N, typename U, typename = enable_if_scalar_t<U>> \
+    FUNC_SIMD_INLINE mask<T,N> operator OP (U a, const pack<T,N>& b){ \
+        return pack<T,N>::broadcast(static_cast<T>(a)) OP b; \
+    }
+
+    FUNC_PACK_COMPARISON(<)
+    FUNC_PACK_COMPARISON(<=)
+    FUNC_PACK_COMPARISON(>)
+    FUNC_PACK_COMPARISON(>=)
+    FUNC_PACK_COMPARISON(==)
+    FUNC_PACK_COMPARISON(!=)
+
+#undef FUNC_PACK_COMPARISON
+
+#define FUNC_MASK_OPERATOR(OP) \
+    template <typename T, unsigned N> \
+    FUNC_SIMD_INLINE mask<T,N> operator OP (const mask<T,N>& a, const mask<T,N>& b){ \
+        using S = typename mask<T,N>::lane_type; \
+        mask<T,N> r; \
+        FUNC_SIMD_LANEWISE(S, r.bits.v, S, a.bits.v, b.bits.v, OP, +) \
+        return r; \
+    }
+
+    FUNC_MASK_OPERATOR(&)
+    FUNC_MASK_OPERATOR(|)
+    FUNC_MASK_OPERATOR(^)
+
+#undef FUNC_MASK_OPERATOR
+#undef FUNC_SIMD_LANEWISE
+
+    // no short circuit, every lane needs both sides
+    template <typename T, unsigned N>
+    FUNC_SIMD_INLINE mask<T,N> operator&& (const mask<T,N>& a, const mask<T,N>& b){
+        return a & b;
+    }
+
+    template <typename T, unsigned N>
+    FUNC_SIMD_INLINE mask<T,N> operator|| (const mask<T,N>& a, const mask<T,N>& b){
+        return a | b;
+    }
+
+    template <typename T, unsigned N>
+    FUNC_SIMD_INLINE mask<T,N> operator! (const mask<T,N>& a){
+        mask<T,N> all;
+        for (unsigned i = 0; i < N; ++i) all.bits.v[i] = -1;
+        return a ^ all;
+    }
+
+    // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+    /*
+     * allocator for outputs, aligned to the widest vector register. Elements are
+     * default initialized, resizing a vector of numbers does not write zeros
+     * which are to be overwritten
+     */
+    template <typename T, std::size_t Align = 64>
+    struct aligned_allocator{
+
+        using value_type = T;
+
+        template <typename U>
+        struct rebind { using other = aligned_allocator<U, Align>; };
+
+        aligned_allocator() {}
+        template <typename U>
+        aligned_allocator(const aligned_allocator<U, Align>&) {}
+
+        T* allocate(std::size_t n){
+            void* raw = ::operator new(n*sizeof(T) + Align + sizeof(void*));
+            std::uintptr_t p = (reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*) + Align-1) & ~std::uintptr_t(Align-1);
+            reinterpret_cast<void**>(p)[-1] = raw;
+            return reinterpret_cast<T*>(p);
+        }
+
+        void deallocate(T* p, std::size_t){
+            ::operator delete(reinterpret_cast<void**>(p)[-1]);
+        }
+
+        template <typename U>
+        void construct(U* p){
+            ::new (static_cast<void*>(p)) U;
+        }
+
+        template <typename U, typename... Args>
+        void construct(U* p, Args&&... args){
+            ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+        }
+
+        template <typename U>
+        bool operator== (const aligned_allocator<U, Align>&) const { return true; }
+        template <typename U>
+        bool operator!= (const aligned_allocator<U, Align>&) const { return false; }
+    };
+
+    template <typename T>
+    using vector = std::vector<T, aligned_allocator<T>>;
+
+    // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+    enum class level { scalar, sse, avx2, avx512 };
+
+    // widest instruction set of this machine, checked once
+    inline level support(){
+#if FUNC_SIMD_DISPATCH
+        static const level l = [](){
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f")) return level::avx512;
+            if (__builtin_cpu_supports("avx2"))    return level::avx2;
+            if (__builtin_cpu_supports("sse2"))    return level::sse;
+            return level::scalar;
+        }();
+        return l;
+#else
+        return level::scalar;
+#endif
+    }
+
+    // lanes of T in a register of the given width
+    template <typename T>
+    constexpr unsigned lanes(unsigned bytes){
+        return bytes / sizeof(T) > 0? bytes / sizeof(T): 1;
+    }
+
+    // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+    /*
+     * functors are only evaluated on packs when they say so, by specializing is_lanewise
+     * or wrapped by lanewise(f). Finding it out by calling them on a pack would compile
+     * their bodies for packs, a hard error for std::sqrt, ?: or a branch on the value.
+     * Any other functor is evaluated element by element
+     */
+    template <typename F>
+    struct is_lanewise : std::false_type { };
+
+    template <typename F>
+    struct lanewise_t{
+        F f;
+
+        template <typename X>
+        FUNC_SIMD_INLINE auto operator()(const X& x) const -> decltype(f(x)) {
+            return f(x);
+        }
+    };
+
+    template <typename F>
+    struct is_lanewise<lanewise_t<F>> : std::true_type { };
+
+    template <typename F>
+    lanewise_t<F> lanewise(F f){
+        return lanewise_t<F>{f};
+    }
+
+namespace detail{
+
+    template <typename F, typename T>
+    using result_t = func::detail::remove_all_t<decltype(std::declval<F&>()(std::declval<const T&>()))>;
+
+    template <typename F, typename T, unsigned N, typename = void>
+    struct pack_result : std::false_type { };
+
+    template <typename F, typename T, unsigned N>
+    struct pack_result<F, T, N, typename func::detail::make_void<result_t<F, pack<T,N>>>::type>
+    : std::is_same<result_t<F, pack<T,N>>, pack<result_t<F, T>, N>> { };
+
+    // the functor is lanewise, and produces the pack of its scalar result
+    template <typename F, typename T, unsigned N>
+    struct lane_callable : std::conditional<is_lanewise<F>::value, pack_result<F, T, N>, std::false_type>::type { };
+
+    template <unsigned N, typename F, typename T, typename R>
+    FUNC_SIMD_INLINE void kernel(F& f, const T* in, std::size_t n, R* out, std::true_type){
+        const std::size_t body = n - n % N;
+        for (std::size_t i = 0; i < body; i += N){
+            f(pack<T,N>::load(in + i)).store(out + i);
+        }
+        // tail
+        for (std::size_t i = body; i < n; ++i){
+            out[i] = f(in[i]);
+        }
+    }
+
+    template <unsigned N, typename F, typename T, typename R>
+    FUNC_SIMD_INLINE void kernel(F& f, const T* in, std::size_t n, R* out, std::false_type){
+        for (std::size_t i = 0; i < n; ++i){
+            out[i] = f(in[i]);
+        }
+    }
+
+    template <unsigned Bytes, typename F, typename T, typename R>
+    FUNC_SIMD_INLINE void kernel(F& f, const T* in, std::size_t n, R* out){
+        kernel<lanes<T>(Bytes)>(f, in, n, out, lane_callable<F, T, lanes<T>(Bytes)>());
+    }
+
+#if FUNC_SIMD_DISPATCH
+    template <typename F, typename T, typename R>
+    __attribute__((target("sse2"))) void kernel_sse(F& f, const T* in, std::size_t n, R* out){
+        kernel<16>(f, in, n, out);
+    }
+
+    template <typename F, typename T, typename R>
+    __attribute__((target("avx2"))) void kernel_avx2(F& f, const T* in, std::size_t n, R* out){
+        kernel<32>(f, in, n, out);
+    }
+
+    template <typename F, typename T, typename R>
+    __attribute__((target("avx512f"))) void kernel_avx512(F& f, const T* in, std::size_t n, R* out){
+        kernel<64>(f, in, n, out);
+    }
+#endif
+
+    // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+    template <typename P, typename T, unsigned N, typename = void>
+    struct mask_result : std::false_type { };
+
+    template <typename P, typename T, unsigned N>
+    struct mask_result<P, T, N, typename func::detail::make_void<result_t<P, pack<T,N>>>::type>
+    : std::is_same<result_t<P, pack<T,N>>, mask<T,N>> { };
+
+    // the predicate is lanewise, and produces a mask
+    template <typename P, typename T, unsigned N>
+    struct lane_predicate : std::conditional<is_lanewise<P>::value, mask_result<P, T, N>, std::false_type>::type { };
+
+    /*
+     * stores the lanes which hold at the front of out, returns how many. Every lane is
+     * written and the cursor only advances over the selected ones: there is no branch
+     * to mispredict. out has room for the whole pack. Specialized by register width
+     * and lane size
+     */
+    template <unsigned Bytes, std::size_t Size>
+    struct compressor{
+        template <typename T, unsigned N>
+        static FUNC_SIMD_INLINE std::size_t apply(const pack<T,N>& x, const mask<T,N>& m, T* out){
+            std::size_t k = 0;
+            for (unsigned i = 0; i < N; ++i){
+                out[k] = x[i];
+                k += m.bits[i] & 1;
+            }
+            return k;
+        }
+    };
+
+#if FUNC_SIMD_DISPATCH
+    /*
+     * AVX2 has no compress, lanes are moved to the front by a permutation looked up
+     * by the mask bits. Indices are for 32 bit lanes, wider ones take consecutive pairs
+     */
+    template <unsigned L>
+    struct permutation_table{
+        std::int32_t idx[1 << L][8];
+
+        constexpr permutation_table() : idx() {
+            for (unsigned m = 0; m < (1u << L); ++m){
+                unsigned k = 0;
+                for (unsigned i = 0; i < L; ++i){
+                    if (!(m & (1u << i))) continue;
+                    for (unsigned w = 0; w < 8/L; ++w) idx[m][k++] = i*(8/L) + w;
+                }
+            }
+        }
+    };
+
+    template <unsigned L>
+    struct permutations{
+        static constexpr permutation_table<L> table {};
+    };
+
+    template <unsigned L>
+    constexpr permutation_table<L> permutations<L>::table;
+
+    template <>
+    struct compressor<32, 4>{
+        template <typename T>
+        __attribute__((target("avx2"))) static inline std::size_t apply(const pack<T,8>& x, const mask<T,8>& m, T* out){
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x.v));
+            int bits = _mm256_movemask_ps(_mm256_loadu_ps(reinterpret_cast<const float*>(m.bits.v)));
+            __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(permutations<8>::table.idx[bits]));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_permutevar8x32_epi32(v, idx));
+            return __builtin_popcount(bits);
+        }
+    };
+
+    template <>
+    struct compressor<32, 8>{
+        template <typename T>
+        __attribute__((target("avx2"))) static inline std::size_t apply(const pack<T,4>& x, const mask<T,4>& m, T* out){
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x.v));
+            int bits = _mm256_movemask_pd(_mm256_loadu_pd(reinterpret_cast<const double*>(m.bits.v)));
+            __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(permutations<4>::table.idx[bits]));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_permutevar8x32_epi32(v, idx));
+            return __builtin_popcount(bits);
+        }
+    };
+
+    // AVX-512 compress store
+    template <>
+    struct compressor<64, 4>{
+        template <typename T>
+        __attribute__((target("avx512f"))) static inline std::size_t apply(const pack<T,16>& x, const mask<T,16>& m, T* out){
+            __m512i v = _mm512_loadu_si512(x.v);
+            __m512i b = _mm512_loadu_si512(m.bits.v);
+            __mmask16 k = _mm512_test_epi32_mask(b, b);
+            _mm512_mask_compressstoreu_epi32(out, k, v);
+            return __builtin_popcount(k);
+        }
+    };
+
+    template <>
+    struct compressor<64, 8>{
+        template <typename T>
+        __attribute__((target("avx512f"))) static inline std::size_t apply(const pack<T,8>& x, const mask<T,8>& m, T* out){
+            __m512i v = _mm512_loadu_si512(x.v);
+            __m512i b = _mm512_loadu_si512(m.bits.v);
+            __mmask8 k = _mm512_test_epi64_mask(b, b);
+            _mm512_mask_compressstoreu_epi64(out, k, v);
+            return __builtin_popcount(k);
+        }
+    };
+#endif
+
+    template <unsigned Bytes, typename P, typename T>
+    FUNC_SIMD_INLINE std::size_t filter_kernel(P& p, const T* in, std::size_t n, T* out, std::true_type){
+        constexpr unsigned N = lanes<T>(Bytes);
+        const std::size_t body = n - n % N;
+        std::size_t k = 0;
+        for (std::size_t i = 0; i < body; i += N){
+            auto x = pack<T,N>::load(in + i);
+            k += compressor<Bytes, sizeof(T)>::apply(x, p(x), out + k);
+        }
+        // tail
+        for (std::size_t i = body; i < n; ++i){
+            out[k] = in[i];
+            k += bool(p(in[i]));
+        }
+        return k;
+    }
+
+    template <unsigned Bytes, typename P, typename T>
+    FUNC_SIMD_INLINE std::size_t filter_kernel(P& p, const T* in, std::size_t n, T* out, std::false_type){
+        std::size_t k = 0;
+        for (std::size_t i = 0; i < n; ++i){
+            out[k] = in[i];
+            k += bool(p(in[i]));
+        }
+        return k;
+    }
+
+    template <unsigned Bytes, typename P, typename T>
+    FUNC_SIMD_INLINE std::size_t filter_kernel(P& p, const T* in, std::size_t n, T* out){
+        return filter_kernel<Bytes>(p, in, n, out, lane_predicate<P, T, lanes<T>(Bytes)>());
+    }
+
+#if FUNC_SIMD_DISPATCH
+    template <typename P, typename T>
+    __attribute__((target("sse2"))) std::size_t filter_sse(P& p, const T* in, std::size_t n, T* out){
+        return filter_kernel<16>(p, in, n, out);
+    }
+
+    template <typename P, typename T>
+    __attribute__((target("avx2"))) std::size_t filter_avx2(P& p, const T* in, std::size_t n, T* out){
+        return filter_kernel<32>(p, in, n, out);
+    }
+
+    template <typename P, typename T>
+    __attribute__((target("avx512f"))) std::size_t filter_avx512(P& p, const T* in, std::size_t n, T* out){
+        return filter_kernel<64>(p, in, n, out);
+    }
+#endif
+
+} // detail
+
+    /*
+     * out[i] = f(in[i]) for n contiguous elements, f is evaluated on packs of as many
+     * lanes as the instruction set fits, and on single elements for the tail. The
+     * instruction set can be lowered, not raised above what the machine supports
+     */
+    template <typename F, typename T, typename R>
+    R* transform_n(F& f, const T* in, std::size_t n, R* out, level l = support()){
+        if (l > support()) l = support();
+        switch (l){
+#if FUNC_SIMD_DISPATCH
+            case level::avx512: detail::kernel_avx512(f, in, n, out); break;
+            case level::avx2:   detail::kernel_avx2(f, in, n, out);   break;
+            case level::sse:    detail::kernel_sse(f, in, n, out);    break;
+#endif
+            default:            detail::kernel<16>(f, in, n, out);    break;
+        }
+        return out + n;
+    }
+
+    /*
+     * copies the elements of in which satisfy p to the front of out, in order. Returns
+     * the end of the copied elements. p is evaluated on packs into masks, the selected
+     * lanes are compacted without branches. out needs room for n elements
+     */
+    template <typename P, typename T>
+    T* filter_n(P& p, const T* in, std::size_t n, T* out, level l = support()){
+        if (l > support()) l = support();
+        switch (l){
+#if FUNC_SIMD_DISPATCH
+            case level::avx512: return out + detail::filter_avx512(p, in, n, out);
+            case level::avx2:   return out + detail::filter_avx2(p, in, n, out);
+            case level::sse:    return out + detail::filter_sse(p, in, n, out);
+#endif
+            default:            return out + detail::filter_kernel<16>(p, in, n, out);
+        }
+    }
+
+} // simd
+
+namespace detail{
+
+    // contiguous storage of numbers
+    template <typename C, typename = void>
+    struct is_simd_source : std::false_type { };
+
+    template <typename C>
+    struct is_simd_source<C, typename make_void<decltype(std::declval<C&>().data()), decltype(std::declval<C&>().size())>::type>
+    : std::is_arithmetic<remove_all_t<decltype(*std::declval<C&>().data())>> { };
+
+    template <typename C>
+    using simd_element_t = remove_all_t<decltype(*std::begin(std::declval<C&>()))>;
+}
+
+    /*
+     * eager transform of a collection into an aligned vector. Contiguous collections of
+     * numbers are processed in packs when the functor is lanewise
+     * (simd::lanewise([](auto x){ return x*2; })); any other collection, or functor, is
+     * evaluated element by element
+     */
+    template <typename F, typename C, typename R = simd::detail::result_t<F, detail::simd_element_t<C>>>
+    typename std::enable_if<detail::is_simd_source<C>::value, R*>::type
+    simd_transform(F f, C& c, R* out){
+        return simd::transform_n(f, c.data(), c.size(), out);
+    }
+
+    template <typename F, typename C, typename R = simd::detail::result_t<F, detail::simd_element_t<C>>>
+    typename std::enable_if<!detail::is_simd_source<C>::value, R*>::type
+    simd_transform(F f, C& c, R* out){
+        for (auto it = c.begin(); it != c.end(); ++it){
+            *out++ = f(*it);
+        }
+        return out;
+    }
+
+    template <typename F, typename C, typename R = simd::detail::result_t<F, detail::simd_element_t<C>>>
+    typename std::enable_if<detail::is_simd_source<C>::value, simd::vector<R>>::type
+    simd_transform(F f, C& c){
+        simd::vector<R> res (c.size());
+        simd::transform_n(f, c.data(), c.size(), res.data());
+        return res;
+    }
+
+    template <typename F, typename C, typename R = simd::detail::result_t<F, detail::simd_element_t<C>>>
+    typename std::enable_if<!detail::is_simd_source<C>::value, simd::vector<R>>::type
+    simd_transform(F f, C& c){
+        simd::vector<R> res;
+        res.reserve(detail::size_hint(c));
+        for (auto it = c.begin(); it != c.end(); ++it){
+            res.push_back(f(*it));
+        }
+        return res;
+    }
+
+    /*
+     * eager filter of a collection into an aligned vector. Contiguous collections of
+     * numbers are filtered in packs when the predicate is lanewise, comparisons of
+     * packs (simd::lanewise([](auto x){ return x > 1 && x < 5; })) produce masks
+     */
+    template <typename P, typename C, typename T = detail::simd_element_t<C>>
+    typename std::enable_if<detail::is_simd_source<C>::value, T*>::type
+    simd_filter(P p, C& c, T* out){
+        return simd::filter_n(p, c.data(), c.size(), out);
+    }
+
+    template <typename P, typename C, typename T = detail::simd_element_t<C>>
+    typename std::enable_if<!detail::is_simd_source<C>::value, T*>::type
+    simd_filter(P p, C& c, T* out){
+        for (auto it = c.begin(); it != c.end(); ++it){
+            if (p(*it)) *out++ = *it;
+        }
+        return out;
+    }
+
+    template <typename P, typename C, typename T = detail::simd_element_t<C>>
+    typename std::enable_if<detail::is_simd_source<C>::value, simd::vector<T>>::type
+    simd_filter(P p, C& c){
+        simd::vector<T> res (c.size());
+        res.resize(simd::filter_n(p, c.data(), c.size(), res.data()) - res.data());
+        return res;
+    }
+
+    template <typename P, typename C, typename T = detail::simd_element_t<C>>
+    typename std::enable_if<!detail::is_simd_source<C>::value, simd::vector<T>>::type
+    simd_filter(P p, C& c){
+        simd::vector<T> res;
+        res.reserve(detail::size_hint(c));
+        for (auto it = c.begin(); it != c.end(); ++it){
+            if (p(*it)) res.push_back(*it);
+        }
+        return res;
+    }
+
+} // func
@@ -0,0 +1,92 @@
+/**
+	FunctionalCpp,  A header only library for chainable functional operations
+	in C++ collections
+    Copyright (C) 2016 Luis F. Ayuso & Stefan Moosbrugger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <iterator>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "parallel.h"
+
+namespace func{
+namespace detail{
+
+    // appends the records delimited in [b, e) to res, a trailing empty record is not produced
+    template <typename Record, typename Iter, typename Char>
+    void split_range(Iter b, Iter e, const Char& delim, std::vector<Record>& res){
+        while (b != e){
+            Iter d = std::find(b, e, delim);
+            res.emplace_back(b, d);
+            if (d == e) return;
+            b = d;
+            ++b;
+        }
+    }
+
+    // first position after a delimiter at or after pos-1, or n if there is none
+    template <typename Iter, typename Char>
+    std::size_t snap_to_record(Iter beg, std::size_t pos, std::size_t n, const Char& delim){
+        if (pos == 0) return 0;
+        Iter d = std::find(beg + (pos-1), beg + n, delim);
+        return d == beg + n? n: (d - beg) +1;
+    }
+
+} // detail namespace
+
+    /*
+     * splits a buffer in records separated by delim, as a mux reading up to the next
+     * delimiter would do. The buffer is cut in ranges, each range boundary is moved
+     * forward to the beginning of the next record, and the ranges are tokenized
+     * concurrently. The records are returned in order.
+     *
+     * The buffer needs random access iterators, Record is built from a pair of them.
+     */
+    template <typename Record = std::string, typename Buffer, typename Char>
+    std::vector<Record> parallel_split(const Buffer& buffer, const Char& delim){
+
+        auto beg = std::begin(buffer);
+        std::size_t n = std::end(buffer) - beg;
+
+        std::size_t parts = detail::parallel_parts(n);
+        if (parts <= 1){
+            std::vector<Record> res;
+            detail::split_range(beg, beg + n, delim, res);
+            return res;
+        }
+
+        std::vector<std::size_t> start(parts +1, n);
+        auto snap = [&](std::size_t from, std::size_t to){
+            for (std::size_t p = from; p < to; ++p){
+                start[p] = detail::snap_to_record(beg, n * p / parts, n, delim);
+            }
+        };
+        exec::parallel_for(parts, snap);
+
+        std::vector<std::vector<Record>> records(parts);
+        auto tokenize = [&](std::size_t from, std::size_t to){
+            for (std::size_t p = from; p < to; ++p){
+                detail::split_range(beg + start[p], beg + start[p+1], delim, records[p]);
+            }
+        };
+        exec::parallel_for(parts, tokenize);
+
+        return detail::concat_parts(records);
+    }
+}
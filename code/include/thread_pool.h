@@ -0,0 +1,300 @@
+/**
+	FunctionalCpp,  A header only library for chainable functional operations
+	in C++ collections
+    Copyright (C) 2016 Luis F. Ayuso & Stefan Moosbrugger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <memory>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include <cassert>
+
+namespace func{
+namespace exec{
+
+    /*
+     * Persistent work-stealing pool:
+     *  - each worker owns a deque, it pushes and pops its own work at the back.
+     *  - idle workers steal from the front of a random victim.
+     *  - tasks submitted from outside the pool are distributed round robin.
+     *  - threads waiting for work to finish (task_group::wait) help executing tasks,
+     *    so nested parallel regions do not deadlock.
+     */
+    class thread_pool{
+
+        using task = std::function<void()>;
+
+        struct worker_queue{
+            std::mutex lock;
+            std::deque<task> tasks;
+        };
+
+        // identifies the worker running in the current thread, if any
+        struct worker_id{
+            const thread_pool* pool = nullptr;
+            unsigned index = 0;
+        };
+
+        static worker_id& local(){
+            static thread_local worker_id id;
+            return id;
+        }
+
+        static std::minstd_rand& local_random(){
+            static thread_local std::minstd_rand gen(std::hash<std::thread::id>()(std::this_thread::get_id()));
+            return gen;
+        }
+
+        std::vector<std::unique_ptr<worker_queue>> queues;
+        std::vector<std::thread> workers;
+
+        std::atomic<unsigned> pending;
+        std::atomic<unsigned> next_queue;
+        std::atomic<bool> stop;
+
+        std::mutex sleep_lock;
+        std::condition_variable wake_up;
+
+        bool pop_local(unsigned i, task& t){
+            worker_queue& q = *queues[i];
+            std::lock_guard<std::mutex> guard(q.lock);
+            if (q.tasks.empty()) return false;
+            t = std::move(q.tasks.back());
+            q.tasks.pop_back();
+            return true;
+        }
+
+        bool steal(unsigned i, task& t){
+            worker_queue& q = *queues[i];
+            std::unique_lock<std::mutex> guard(q.lock, std::try_to_lock);
+            if (!guard.owns_lock() || q.tasks.empty()) return false;
+            t = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            return true;
+        }
+
+        bool try_get(task& t){
+
+            if (pending.load(std::memory_order_acquire) == 0) return false;
+
+            const unsigned n = queues.size();
+            const worker_id& me = local();
+            if (me.pool == this && pop_local(me.index, t)){
+                --pending;
+                return true;
+            }
+
+            unsigned victim = local_random()() % n;
+            for (unsigned i = 0; i < n; ++i){
+                if (steal((victim + i) % n, t)){
+                    --pending;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void work(unsigned index){
+
+            local().pool = this;
+            local().index = index;
+
+            task t;
+            while (!stop){
+                if (try_get(t)){
+                    t();
+                    t = nullptr;
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> guard(sleep_lock);
+                wake_up.wait(guard, [this]() { return stop || pending > 0; });
+            }
+        }
+
+    public:
+
+        explicit thread_pool(unsigned size)
+        : pending(0), next_queue(0), stop(false) {
+
+            size = std::max(size, 1u);
+            for (unsigned i = 0; i < size; ++i){
+                queues.emplace_back(new worker_queue());
+            }
+            for (unsigned i = 0; i < size; ++i){
+                workers.emplace_back([this, i]() { work(i); });
+            }
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator= (const thread_pool&) = delete;
+
+        ~thread_pool(){
+            {
+                std::lock_guard<std::mutex> guard(sleep_lock);
+                stop = true;
+            }
+            wake_up.notify_all();
+            for (auto& w : workers) w.join();
+        }
+
+        // number of worker threads
+        unsigned size() const{
+            return workers.size();
+        }
+
+        // number of threads taking part in a parallel region, the caller helps as well
+        unsigned concurrency() const{
+            return size() +1;
+        }
+
+        void submit(task t){
+
+            const worker_id& me = local();
+            unsigned i = (me.pool == this)? me.index : next_queue++ % queues.size();
+            {
+                // counted before it is visible, so it never goes below zero when stolen.
+                // the lock prevents the wake up from being lost between the predicate
+                // check and the wait of a sleeping worker
+                std::lock_guard<std::mutex> guard(sleep_lock);
+                ++pending;
+            }
+            {
+                std::lock_guard<std::mutex> guard(queues[i]->lock);
+                queues[i]->tasks.push_back(std::move(t));
+            }
+            wake_up.notify_one();
+        }
+
+        // executes one pending task in the calling thread, if any.
+        bool run_one(){
+            task t;
+            if (!try_get(t)) return false;
+            t();
+            return true;
+        }
+
+        /*
+         * the default pool, started at first use. The size can be set with
+         * the FUNC_NUM_THREADS environment variable, otherwise one worker per
+         * hardware thread is spawned (the calling thread makes the last one).
+         */
+        static thread_pool& instance(){
+            static thread_pool pool(default_size());
+            return pool;
+        }
+
+        static unsigned default_size(){
+            if (const char* env = std::getenv("FUNC_NUM_THREADS")){
+                int n = std::atoi(env);
+                if (n > 0) return n;
+            }
+            unsigned hw = std::thread::hardware_concurrency();
+            return hw > 1? hw-1: 1;
+        }
+    };
+
+    /*
+     * a set of tasks which can be waited for. The waiting thread executes
+     * pending tasks instead of blocking. The first exception thrown by a task
+     * is rethrown by wait()
+     */
+    class task_group{
+
+        thread_pool& pool;
+        std::atomic<unsigned> running;
+        std::exception_ptr error;
+        std::mutex error_lock;
+
+    public:
+
+        explicit task_group(thread_pool& pool = thread_pool::instance())
+        : pool(pool), running(0) {}
+
+        task_group(const task_group&) = delete;
+        task_group& operator= (const task_group&) = delete;
+
+        ~task_group(){
+            assert(running == 0 && "task group destroyed without waiting");
+        }
+
+        template <typename F>
+        void run(F f){
+            ++running;
+            pool.submit([this, f]() mutable {
+                try{
+                    f();
+                }catch(...){
+                    std::lock_guard<std::mutex> guard(error_lock);
+                    if (!error) error = std::current_exception();
+                }
+                --running;
+            });
+        }
+
+        void wait(){
+            while (running > 0){
+                if (!pool.run_one()) std::this_thread::yield();
+            }
+            if (error) std::rethrow_exception(error);
+        }
+    };
+
+    /*
+     * runs body(from, to) over chunks of [0, n). The range is split in more
+     * chunks than threads so idle workers can steal the remaining work when
+     * the cost per element is not uniform. Chunk boundaries are multiple of
+     * the alignment.
+     */
+    template <typename Body>
+    void parallel_for(thread_pool& pool, std::size_t n, Body& body, std::size_t alignment = 1){
+
+        static const std::size_t chunks_per_thread = 4;
+
+        std::size_t blocks = (n + alignment -1) / alignment;
+        std::size_t chunks = std::min<std::size_t>(blocks, pool.concurrency() * chunks_per_thread);
+        if (chunks <= 1){
+            if (n) body(std::size_t(0), n);
+            return;
+        }
+
+        std::size_t chunk = (blocks + chunks -1) / chunks * alignment;
+
+        task_group group(pool);
+        for (std::size_t from = 0; from < n; from += chunk){
+            std::size_t to = std::min(from + chunk, n);
+            group.run([&body, from, to]() { body(from, to); });
+        }
+        group.wait();
+    }
+
+    template <typename Body>
+    void parallel_for(std::size_t n, Body& body, std::size_t alignment = 1){
+        parallel_for(thread_pool::instance(), n, body, alignment);
+    }
+
+} // exec namespace
+} // func namespace
@@ -19,10 +19,12 @@
 
 #pragma once
 #include <iterator>
+#include <utility>
 
 #include "detail/utils.h"
 #include "detail/iterators.h"
 #include "detail/chaineable.h"
+#include "detail/stages.h"
 
 namespace func{
 namespace it{
@@ -30,15 +32,25 @@ namespace it{
     template<typename Value, typename Source, typename Func>
     struct TransformIterator : public detail::iterator_type<TransformIterator<Value, Source, Func>, Value> {
 
-        Func& f;
+        // held by address so the iterator can be default constructed and assigned
+        detail::stage_fn<Func> f;
         Source s;
 
         using source_type = Source;
         using self_type = TransformIterator<Value, Source, Func>;
+        using difference_type = typename std::iterator_traits<self_type>::difference_type;
+
+        TransformIterator()
+        : f(), s() {}
 
         TransformIterator(Func& f, const Source& s, const Source&)
         :f(f), s(s) {}
 
+        // fused stage: the outer functor on top of the iterator of the nested transform
+        template <typename F, typename A, typename G>
+        TransformIterator(F& f, const TransformIterator<A,Source,G>& s, const TransformIterator<A,Source,G>&)
+        :f(f, s.f), s(s.s) {}
+
         TransformIterator(const TransformIterator& o)
         : f(o.f), s(o.s)
         {}
@@ -48,11 +60,13 @@ namespace it{
         {}
 
         TransformIterator& operator= (const TransformIterator& o){
+            f = o.f;
             s = o.s;
             return *this;
         }
 
         TransformIterator& operator= (TransformIterator&& o){
+            f = o.f;
             std::swap(s, o.s);
             return *this;
         }
@@ -99,36 +113,120 @@ namespace it{
             return cpy;
         }
 
+        // over random access sources the block is a counted loop, which the compiler can vectorize
+        std::size_t next_block(Value* out, std::size_t n, const self_type& end){
+            return block(out, n, end.s, detail::is_ra_iterator<Source>());
+        }
+
         template <typename S = self_type, typename = typename std::enable_if<S::is_parallel_iterator>::type>
-        Value operator[](unsigned i) {
+        Value operator[](difference_type i) const {
             return f(s[i]);
         }
 
         template <typename S = self_type, typename = typename std::enable_if<S::is_parallel_iterator>::type>
-        S operator+ (int i) {
-            return S(f, s+i, s);
+        S& operator+= (difference_type i) {
+            s += i;
+            return *this;
+        }
+
+        template <typename S = self_type, typename = typename std::enable_if<S::is_parallel_iterator>::type>
+        S& operator-= (difference_type i) {
+            s -= i;
+            return *this;
+        }
+
+        template <typename S = self_type, typename = typename std::enable_if<S::is_parallel_iterator>::type>
+        S& operator--() {
+            --s;
+            return *this;
+        }
+
+        template <typename S = self_type, typename = typename std::enable_if<S::is_parallel_iterator>::type>
+        S operator--(int) {
+            S cpy = *this;
+            --s;
+            return cpy;
+        }
+
+        template <typename S = self_type, typename = typename std::enable_if<S::is_parallel_iterator>::type>
+        S operator+ (difference_type i) const {
+            S cpy = *this;
+            return cpy += i;
         }
 
         template <typename S = self_type, typename = typename std::enable_if<S::is_parallel_iterator>::type>
-        S operator- (int i) {
-            return S(f, s-i, s);
+        S operator- (difference_type i) const {
+            S cpy = *this;
+            return cpy -= i;
         }
 
         template <typename S = self_type, typename = typename std::enable_if<S::is_parallel_iterator>::type>
-        typename std::iterator_traits<S>::difference_type operator- (const S& o) {
+        difference_type operator- (const S& o) const {
             return s-o.s;
         }
 
+        template <typename S = self_type, typename = typename std::enable_if<S::is_parallel_iterator>::type>
+        bool operator< (const S& o) const { return s < o.s; }
+
+        template <typename S = self_type, typename = typename std::enable_if<S::is_parallel_iterator>::type>
+        bool operator> (const S& o) const { return o.s < s; }
+
+        template <typename S = self_type, typename = typename std::enable_if<S::is_parallel_iterator>::type>
+        bool operator<= (const S& o) const { return !(o.s < s); }
+
+        template <typename S = self_type, typename = typename std::enable_if<S::is_parallel_iterator>::type>
+        bool operator>= (const S& o) const { return !(s < o.s); }
+
+        template <typename S = self_type, typename = typename std::enable_if<S::is_parallel_iterator>::type>
+        friend S operator+ (difference_type i, const self_type& it) {
+            return it + i;
+        }
+
+    private:
+
+        std::size_t block(Value* out, std::size_t n, const Source& end, std::true_type){
+            std::size_t left = end - s;
+            std::size_t m = n < left? n: left;
+            for (std::size_t i = 0; i < m; ++i){
+                out[i] = f(s[i]);
+            }
+            s += m;
+            return m;
+        }
+
+        std::size_t block(Value* out, std::size_t n, const Source& end, std::false_type){
+            std::size_t k = 0;
+            for (; k < n && s != end; ++k, ++s){
+                out[k] = f(*s);
+            }
+            return k;
+        }
     };
 } // it namespace
 
-   template <typename FuncType, typename Container, typename Storage_type>
+namespace detail{
+
+    // a transform over a transform iterates directly the innermost source with the composition
+    // of both functors, no matter how deep the nesting is
+    template <typename Value, typename Source, typename Func>
+    struct transform_iterator{
+        using type = it::TransformIterator<Value, Source, Func>;
+    };
+
+    template <typename Value, typename A, typename S, typename G, typename Func>
+    struct transform_iterator<Value, it::TransformIterator<A, S, G>, Func>{
+        using type = it::TransformIterator<Value, S, composed<Func, G>>;
+    };
+}
+
+   template <typename FuncType, typename Container, typename Storage_type, typename Policy = detail::policy_of_t<Container>>
     using transform_t = detail::chaineable_t<
                             FuncType,
                             Container,
                             Storage_type,
                             typename detail::get_lambda<FuncType,Container>::return_type,
-                            it::TransformIterator<typename detail::get_lambda<FuncType,Container>::return_type, typename Container::iterator, FuncType > // specific iterator type for transformation
+                            typename detail::transform_iterator<typename detail::get_lambda<FuncType,Container>::return_type, typename Container::iterator, FuncType >::type, // specific iterator type for transformation
+                            Policy
                                 >;
 
 
@@ -163,4 +261,20 @@ namespace it{
     transform(F f, C&& c){
         return transform_t<F,C,detail::Value_storage> (f, detail::chaineable_store_t<C,detail::Value_storage> (std::move(c)));
     }
+
+    // with execution policy
+    // lvalue collection
+    template <typename P, typename F, typename C, typename = detail::enable_if_policy_t<P>>
+    transform_t<F, C, detail::Reference_storage, P>
+    transform(const P&, F f, C& c){
+        return transform_t<F,C,detail::Reference_storage,P> (f, detail::chaineable_store_t<C,detail::Reference_storage> (c));
+    }
+
+    // with execution policy
+    // xvalue collection
+    template <typename P, typename F, typename C, typename = detail::enable_if_policy_t<P>>
+    transform_t<F, C, detail::Value_storage, P>
+    transform(const P&, F f, C&& c){
+        return transform_t<F,C,detail::Value_storage,P> (f, detail::chaineable_store_t<C,detail::Value_storage> (std::move(c)));
+    }
 }
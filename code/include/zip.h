@@ -21,6 +21,7 @@
 #include <iterator>
 #include <cassert>
 #include <algorithm>
+#include <utility>
 
 #include "detail/utils.h"
 #include "detail/iterators.h"
@@ -96,25 +97,17 @@ namespace func{
                 std::get<N>(output) = ++std::get<N>(input);
                 trf<T1,T2,N-1>::apply_pp(input, output);
             }
-            static void apply_ind(T1& input, T2& output) {
-                std::get<N>(output) = *std::get<N>(input);
-                trf<T1,T2,N-1>::apply_ind(input, output);
-            }
-            static void apply_plus(T1& input, T2& output, int i) {
+            static void apply_plus(const T1& input, T2& output, std::ptrdiff_t i) {
                 std::get<N>(output) = std::get<N>(input) + i;
                 trf<T1,T2,N-1>::apply_plus(input, output, i);
             }
-            static void apply_minus(T1& input, T2& output, int i) {
+            static void apply_minus(const T1& input, T2& output, std::ptrdiff_t i) {
                 std::get<N>(output) = std::get<N>(input) - i;
                 trf<T1,T2,N-1>::apply_minus(input, output, i);
             }
-            static void apply_bracket(T1& input, T2& output, int i) {
-                std::get<N>(output) = std::get<N>(input)[i];
-                trf<T1,T2,N-1>::apply_bracket(input, output, i);
-            }
-            static void apply_sizes(const T1& iter_input_1, const T1& iter_input_2, T2& target) {
-                target[N] = std::get<N>(iter_input_1)-std::get<N>(iter_input_2);
-                trf<T1,T2,N-1>::apply_sizes(iter_input_1, iter_input_2, target);
+            static void apply_mm(T1& input) {
+                --std::get<N>(input);
+                trf<T1,T2,N-1>::apply_mm(input);
             }
         };
 
@@ -123,20 +116,14 @@ namespace func{
             static void apply_pp(T1& input, T2& output) {
                 std::get<0>(output) = ++std::get<0>(input);
             }
-            static void apply_ind(T1& input, T2& output) {
-                std::get<0>(output) = *std::get<0>(input);
-            }
-            static void apply_plus(T1& input, T2& output, int i) {
+            static void apply_plus(const T1& input, T2& output, std::ptrdiff_t i) {
                 std::get<0>(output) = std::get<0>(input) + i;
             }
-            static void apply_minus(T1& input, T2& output, int i) {
+            static void apply_minus(const T1& input, T2& output, std::ptrdiff_t i) {
                 std::get<0>(output) = std::get<0>(input) - i;
             }
-            static void apply_bracket(T1& input, T2& output, int i) {
-                std::get<0>(output) = std::get<0>(input)[i];
-            }
-            static void apply_sizes(const T1& iter_input_1, const T1& iter_input_2, T2& target) {
-                target[0] = std::get<0>(iter_input_1)-std::get<0>(iter_input_2);
+            static void apply_mm(T1& input) {
+                --std::get<0>(input);
             }
         };
 
@@ -145,153 +132,336 @@ namespace func{
             trf<T, T, std::tuple_size<T>::value-1>::apply_pp(source, target);
         }
         template <typename T, typename V>
-        void asterisk (T& source, V& target){
-            trf<T, V, std::tuple_size<T>::value-1>::apply_ind(source, target);
-        }
-        template <typename T, typename V>
-        void plus (T& source, V& target, int i){
+        void plus (const T& source, V& target, std::ptrdiff_t i){
             trf<T, V, std::tuple_size<T>::value-1>::apply_plus(source, target, i);
         }
         template <typename T, typename V>
-        void minus (T& source, V& target, int i){
+        void minus (const T& source, V& target, std::ptrdiff_t i){
             trf<T, V, std::tuple_size<T>::value-1>::apply_minus(source, target, i);
         }
-        template <typename T, typename V>
-        void bracket (T& source, V& target, int i){
-            trf<T, V, std::tuple_size<T>::value-1>::apply_bracket(source, target, i);
-        }
-        template <typename T, typename V>
-        void sizes (const T& iter_input_1, const T& iter_input_2, V& target) {
-            trf<T, V, std::tuple_size<T>::value-1>::apply_sizes(iter_input_1, iter_input_2, target);
+        template <typename T>
+        void minusminus (T& source){
+            trf<T, T, std::tuple_size<T>::value-1>::apply_mm(source);
         }
 
         /**************** Check if tuple reaches end ******************/
 
-        template <typename T, unsigned  N>
+        template <typename T, typename E, unsigned  N>
         struct check{
-            static bool eq (const T& begin, const T& end){
-                return std::get<N>(begin) == std::get<N>(end) || check<T, N-1>::eq(begin, end);
+            static bool eq (const T& begin, const E& end){
+                return detail::at_end(std::get<N>(begin), std::get<N>(end)) || check<T, E, N-1>::eq(begin, end);
             }
         };
-        template <typename T>
-        struct check<T, 0>{
-            static bool eq (const T& begin, const T& end){
-                return std::get<0>(begin) == std::get<0>(end);
+        template <typename T, typename E>
+        struct check<T, E, 0>{
+            static bool eq (const T& begin, const E& end){
+                return detail::at_end(std::get<0>(begin), std::get<0>(end));
             }
         };
 
-        template <typename T>
-        bool is_end(const T& begin, const T& end){
-            return check<T, std::tuple_size<T>::value -1>::eq(begin, end);
+        template <typename T, typename E>
+        bool is_end(const T& begin, const E& end){
+            return check<T, E, std::tuple_size<T>::value -1>::eq(begin, end);
         }
+
+        /************ the ends kept by a zip, only for the iterators which need one ************/
+
+        template <typename T>
+        struct end_slots;
+
+        template <typename... Its>
+        struct end_slots<std::tuple<Its...>>{
+            using type = std::tuple<detail::end_slot_t<Its>...>;
+        };
+
+        template <typename A, typename B>
+        struct end_slots<std::pair<A, B>>{
+            using type = std::pair<detail::end_slot_t<A>, detail::end_slot_t<B>>;
+        };
+
+        template <typename T>
+        using end_slots_t = typename end_slots<T>::type;
     }
 
 namespace it{
     // iterator
     template <typename T, typename Value>
     struct ZipIterator : public detail::iterator_type<ZipIterator<T,Value>, Value> {
-        T source, end;
+        using end_type = end_slots_t<T>;
+
+        // when every input is random access the length is known up front,
+        // a single counter tells the end instead of checking every input
+        using counted = std::integral_constant<bool, detail::iterator_type<ZipIterator<T,Value>, Value>::is_parallel_iterator>;
+
+        T source;
+        end_type end;
+        std::ptrdiff_t left;
         bool finish;
         using inner_type = T;
         using value_type = Value;
 
-        ZipIterator(): finish(true) {}
-        ZipIterator(const T& source, const T& end) : source(source), end(end), finish(is_end(source, end)) { }
+        ZipIterator(): left(0), finish(true) {}
+        ZipIterator(const T& source, const T& end)
+        : source(source), end(end), left(length(counted(), indices())),
+          finish(counted::value? left <= 0: is_end(this->source, this->end)) { }
 
-        ZipIterator(const ZipIterator& o) : source(o.source), end(o.end), finish(o.finish) { }
-        ZipIterator(ZipIterator&& o) : source(std::move(o.source)), end(std::move(o.end)), finish(o.finish) { }
+        ZipIterator(const ZipIterator& o) : source(o.source), end(o.end), left(o.left), finish(o.finish) { }
+        ZipIterator(ZipIterator&& o) : source(std::move(o.source)), end(std::move(o.end)), left(o.left), finish(o.finish) { }
 
         ZipIterator& operator=(const ZipIterator& o){
             source = o.source;
             end = o.end;
+            left = o.left;
             finish = o.finish;
-        };
+            return *this;
+        }
         ZipIterator& operator=(ZipIterator&& o) {
             std::swap(source, o.source);
             std::swap(end, o.end);
+            left = o.left;
             finish = o.finish;
+            return *this;
         }
 
+        // every finished iterator is the end, no matter which collection ran out,
+        // against it the comparison is a single check
         bool operator== (const ZipIterator& o) const {
-           return finish == o.finish || source == o.source;
+           if (finish || o.finish) return finish == o.finish;
+           if (counted::value) return left == o.left;
+           return source == o.source;
         }
 
         bool operator!= (const ZipIterator& o) const {
            return !(*this == o);
         }
 
+        bool at_end() const {
+            return finish;
+        }
+
+        template <typename S = ZipIterator, typename = typename std::enable_if<S::counted::value>::type>
+        std::ptrdiff_t remaining() const {
+            return left;
+        }
+
         ZipIterator& operator++() {
             plusplus(source, source);
-            finish = is_end(source, end);
+            advance(counted(), 1);
             return *this;
         }
 
         ZipIterator operator++(int) {
             ZipIterator cpy = *this;
-            plusplus(source, source);
-            finish = is_end(source, end);
+            ++*this;
             return cpy;
         }
 
+        std::size_t next_block(value_type* out, std::size_t n, const ZipIterator&){
+            return block(out, n, counted());
+        }
+
+        // the aggregate is built from the elements, without default construction nor copies in between
         value_type operator*() {
             assert(!finish && "can not deref end iterator");
-            value_type vals;
-            asterisk(source, vals);
-            return vals;
+            return deref(indices());
         }
 
         template <typename S = ZipIterator, typename = typename std::enable_if<S::is_parallel_iterator>::type>
-        value_type operator[](unsigned i) {
-            value_type x;
-            bracket(source, x, i);
-            return x;
+        value_type operator[](std::ptrdiff_t i) const {
+            return at(i, indices());
         }
 
         template <typename S = ZipIterator, typename = typename std::enable_if<S::is_parallel_iterator>::type>
-        S operator+ (int i) {
+        S& operator+= (std::ptrdiff_t i) {
             //apply operator+ on whole tuple
-            S cpy = *this;
-            plus(source, cpy.source, i);
-            cpy.finish = is_end(cpy.source, cpy.end);
-            return cpy;
+            plus(source, source, i);
+            advance(counted(), i);
+            return *this;
         }
 
         template <typename S = ZipIterator, typename = typename std::enable_if<S::is_parallel_iterator>::type>
-        S operator- (int i) {
+        S& operator-= (std::ptrdiff_t i) {
             //apply operator- on whole tuple
+            minus(source, source, i);
+            advance(counted(), -i);
+            return *this;
+        }
+
+        template <typename S = ZipIterator, typename = typename std::enable_if<S::is_parallel_iterator>::type>
+        S& operator--() {
+            minusminus(source);
+            advance(counted(), -1);
+            return *this;
+        }
+
+        template <typename S = ZipIterator, typename = typename std::enable_if<S::is_parallel_iterator>::type>
+        S operator--(int) {
             S cpy = *this;
-            minus(source, cpy.source, i);
-            cpy.finish = is_end(cpy.source, cpy.end);
+            --*this;
             return cpy;
         }
 
         template <typename S = ZipIterator, typename = typename std::enable_if<S::is_parallel_iterator>::type>
-        typename std::iterator_traits<S>::difference_type operator- (const S& o) {
-            // get the smallest possible distance
-            std::array<unsigned, std::tuple_size<T>::value> s;
-            sizes(source, o.source, s);
-            return *std::min_element(s.begin(),s.end());
+        S operator+ (std::ptrdiff_t i) const {
+            S cpy = *this;
+            return cpy += i;
+        }
+
+        template <typename S = ZipIterator, typename = typename std::enable_if<S::is_parallel_iterator>::type>
+        S operator- (std::ptrdiff_t i) const {
+            S cpy = *this;
+            return cpy -= i;
+        }
+
+        template <typename S = ZipIterator, typename = typename std::enable_if<S::is_parallel_iterator>::type>
+        std::ptrdiff_t operator- (const S& o) const {
+            return o.left - left;
+        }
+
+        template <typename S = ZipIterator, typename = typename std::enable_if<S::is_parallel_iterator>::type>
+        bool operator< (const S& o) const { return (o - *this) > 0; }
+
+        template <typename S = ZipIterator, typename = typename std::enable_if<S::is_parallel_iterator>::type>
+        bool operator> (const S& o) const { return o < *this; }
+
+        template <typename S = ZipIterator, typename = typename std::enable_if<S::is_parallel_iterator>::type>
+        bool operator<= (const S& o) const { return !(o < *this); }
+
+        template <typename S = ZipIterator, typename = typename std::enable_if<S::is_parallel_iterator>::type>
+        bool operator>= (const S& o) const { return !(*this < o); }
+
+        template <typename S = ZipIterator, typename = typename std::enable_if<S::is_parallel_iterator>::type>
+        friend S operator+ (std::ptrdiff_t i, const ZipIterator& it) {
+            return it + i;
+        }
+
+    private:
+
+        using indices = std::make_index_sequence<std::tuple_size<T>::value>;
+
+        // the shortest input bounds the length
+        template <std::size_t... I>
+        std::ptrdiff_t length(std::true_type, std::index_sequence<I...>) const {
+            std::ptrdiff_t s[] = { detail::remaining(std::get<I>(source), std::get<I>(end))... };
+            return *std::min_element(std::begin(s), std::end(s));
+        }
+
+        template <std::size_t... I>
+        std::ptrdiff_t length(std::false_type, std::index_sequence<I...>) const {
+            return 0;
+        }
+
+        void advance(std::true_type, std::ptrdiff_t i) {
+            left -= i;
+            finish = left <= 0;
+        }
+
+        void advance(std::false_type, std::ptrdiff_t) {
+            finish = is_end(source, end);
+        }
+
+        std::size_t block(value_type* out, std::size_t n, std::true_type) {
+            std::size_t m = n < std::size_t(left)? n: std::size_t(left);
+            for (std::size_t i = 0; i < m; ++i){
+                out[i] = at(i, indices());
+            }
+            *this += m;
+            return m;
+        }
+
+        std::size_t block(value_type* out, std::size_t n, std::false_type) {
+            std::size_t k = 0;
+            for (; k < n && !finish; ++k, ++*this){
+                out[k] = deref(indices());
+            }
+            return k;
+        }
+
+        template <std::size_t... I>
+        value_type deref(std::index_sequence<I...>) {
+            return value_type(*std::get<I>(source)...);
+        }
+
+        template <std::size_t... I>
+        value_type at(std::ptrdiff_t i, std::index_sequence<I...>) const {
+            return value_type(std::get<I>(source)[i]...);
         }
     };
 
 } // namespace iterator
 
+namespace detail{
+
+    // const containers provide const iterators
+    template <typename C>
+    using iterator_of_t = decltype(std::declval<C&>().begin());
+
+    // zips produce aggregates of copies of the elements
+    struct zip_values {
+        template <typename C>
+        using element_t = typename C::value_type;
+    };
+
+    // or of what the iterators yield: references into containers, values produced by chains
+    struct zip_references {
+        template <typename C>
+        using element_t = decltype(*std::declval<iterator_of_t<C>&>());
+    };
+}
+
     // chainable
-    template <typename... Args>
-    struct zip_t {
+    template <typename Policy, typename Mode, typename... Args>
+    struct zip_base {
 
         // this tuple contains the storage of the input containers
         std::tuple<Args...> storage;
 
-        using value_type = get_value_type_t<typename Args::stored_type::value_type...>;
-        using inner_iterator_type = get_value_type_t<typename Args::stored_type::iterator...>;
+        using value_type = get_value_type_t<typename Mode::template element_t<typename Args::stored_type>...>;
+        using inner_iterator_type = get_value_type_t<detail::iterator_of_t<typename Args::stored_type>...>;
         using iterator = it::ZipIterator<inner_iterator_type, value_type>;
+        using policy_type = Policy;
+
+    private:
+
+        template <bool... B>
+        struct all_of : std::is_same<all_of<B...>, all_of<(B || true)...>> { };
+
+        using all_sized = all_of<detail::has_size<typename Args::stored_type>::value...>;
+
+        template <std::size_t... I>
+        std::size_t min_size(std::index_sequence<I...>) {
+            std::size_t s[] = { (*std::get<I>(storage)).size()... };
+            return *std::min_element(std::begin(s), std::end(s));
+        }
+
+        template <std::size_t... I>
+        std::size_t min_hint(std::index_sequence<I...>) {
+            // unknown lengths (0) do not bound the zip, the known ones do
+            std::size_t s[] = { detail::size_hint(*std::get<I>(storage))... };
+            std::size_t res = 0;
+            for (auto h : s){
+                if (h != 0 && (res == 0 || h < res)) res = h;
+            }
+            return res;
+        }
+
+    public:
 
         /*
          * it only accepts rvalues to intialize,
          * a helper function needs to be used to construct the containers and pass them
         */
-        zip_t(Args&&... containers) : storage(std::forward<Args>(containers)...) { }
+        zip_base(Args&&... containers) : storage(std::forward<Args>(containers)...) { }
+
+        // length of the shortest collection
+        template <typename Z = zip_base, typename = typename std::enable_if<Z::all_sized::value>::type>
+        std::size_t size() {
+            return min_size(std::index_sequence_for<Args...>());
+        }
+
+        std::size_t size_hint() {
+            return min_hint(std::index_sequence_for<Args...>());
+        }
 
         iterator begin() {
             return aux<iterator, decltype(storage), sizeof...(Args)>::get_begin(this->storage);
@@ -302,6 +472,12 @@ namespace it{
         }
     };
 
+    template <typename Policy, typename... Args>
+    using zip_t = zip_base<Policy, detail::zip_values, Args...>;
+
+    template <typename Policy, typename... Args>
+    using zip_ref_t = zip_base<Policy, detail::zip_references, Args...>;
+
     // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 namespace{
@@ -316,10 +492,38 @@ namespace{
     }
 }
     // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-    template <typename... Args>
-    zip_t<detail::choose_storage_t<func::detail::get_reference_t<Args>>...> zip (Args&&... a) {
+    // the policy is inherited from the zipped collections
+    template <typename A, typename... Args, typename = typename std::enable_if<!detail::is_execution_policy<typename std::decay<A>::type>::value>::type>
+    zip_t<detail::common_policy_t<detail::policy_of_t<A>, detail::policy_of_t<Args>...>, detail::choose_storage_t<func::detail::get_reference_t<A>>, detail::choose_storage_t<func::detail::get_reference_t<Args>>...>
+    zip (A&& a, Args&&... b) {
+        using namespace func::detail;
+        return zip_t<detail::common_policy_t<detail::policy_of_t<A>, detail::policy_of_t<Args>...>, choose_storage_t<get_reference_t<A>>, choose_storage_t<get_reference_t<Args>>...>
+                    (get_storage(std::forward<A>(a)), get_storage(std::forward<Args>(b))...);
+    }
+
+    // with execution policy
+    template <typename P, typename... Args, typename = detail::enable_if_policy_t<P>>
+    zip_t<P, detail::choose_storage_t<func::detail::get_reference_t<Args>>...> zip (const P&, Args&&... a) {
+        using namespace func::detail;
+        return zip_t<P, choose_storage_t<get_reference_t<Args>>...> (get_storage(std::forward<Args>(a))...);
+    }
+
+
+    // zip yielding references to the elements of the containers, and the values
+    // produced by the chains. No element is copied.
+    template <typename A, typename... Args, typename = typename std::enable_if<!detail::is_execution_policy<typename std::decay<A>::type>::value>::type>
+    zip_ref_t<detail::common_policy_t<detail::policy_of_t<A>, detail::policy_of_t<Args>...>, detail::choose_storage_t<func::detail::get_reference_t<A>>, detail::choose_storage_t<func::detail::get_reference_t<Args>>...>
+    zip_ref (A&& a, Args&&... b) {
+        using namespace func::detail;
+        return zip_ref_t<detail::common_policy_t<detail::policy_of_t<A>, detail::policy_of_t<Args>...>, choose_storage_t<get_reference_t<A>>, choose_storage_t<get_reference_t<Args>>...>
+                    (get_storage(std::forward<A>(a)), get_storage(std::forward<Args>(b))...);
+    }
+
+    // with execution policy
+    template <typename P, typename... Args, typename = detail::enable_if_policy_t<P>>
+    zip_ref_t<P, detail::choose_storage_t<func::detail::get_reference_t<Args>>...> zip_ref (const P&, Args&&... a) {
         using namespace func::detail;
-        return zip_t<detail::choose_storage_t<get_reference_t<Args>>...> (get_storage(std::forward<Args>(a))...);
+        return zip_ref_t<P, choose_storage_t<get_reference_t<Args>>...> (get_storage(std::forward<Args>(a))...);
     }
 
 }
@@ -30,6 +30,7 @@
 #include <random>
 
 #include "demux.h"
+#include "parallel.h"
 
 using namespace testing;
 
@@ -98,3 +99,296 @@ TEST(Demux, digits){
         EXPECT_THAT(res, ElementsAre('a','b','a','c','b','a','d','c','b','a'));
     }
 }
+
+TEST(Demux, empty_results){
+
+    // elements producing nothing are skipped
+    std::vector<int> v{0,2,0,0,1,0};
+    auto x = func::demux([](int v) -> std::vector<int>{
+        return std::vector<int>(v, v);
+    }, v);
+
+    std::vector<int> res(x.begin(), x.end());
+    EXPECT_THAT(res, ElementsAre(2,2,1));
+
+    // copies keep their own position
+    auto it = x.begin();
+    auto cpy = it;
+    ++it;
+    EXPECT_EQ(*cpy, 2);
+    EXPECT_EQ(*it, 2);
+    ++it;
+    EXPECT_EQ(*it, 1);
+    EXPECT_EQ(*cpy, 2);
+}
+
+namespace {
+    // counts the allocations of the collections which use it
+    template <typename T>
+    struct counting_allocator{
+        using value_type = T;
+        static int allocations;
+
+        counting_allocator() = default;
+        template <typename U> counting_allocator(const counting_allocator<U>&) {}
+
+        T* allocate(std::size_t n){
+            ++allocations;
+            return std::allocator<T>().allocate(n);
+        }
+        void deallocate(T* p, std::size_t n){
+            std::allocator<T>().deallocate(p, n);
+        }
+        bool operator==(const counting_allocator&) const { return true; }
+        bool operator!=(const counting_allocator&) const { return false; }
+    };
+
+    template <typename T>
+    int counting_allocator<T>::allocations = 0;
+
+    // counts the copies of the values
+    struct tracked {
+        static int copies;
+        int v;
+        tracked(int v = 0) : v(v) {}
+        tracked(const tracked& o) : v(o.v) { ++copies; }
+        tracked& operator= (const tracked& o) { v = o.v; ++copies; return *this; }
+    };
+    int tracked::copies = 0;
+}
+
+TEST(Demux, cheap_copies){
+
+    std::vector<int> v{3,0,2};
+    auto x = func::demux([](int v){
+        std::vector<tracked> res;
+        for (int i = 0; i < v; ++i) res.emplace_back(v*10 + i);
+        return res;
+    }, v);
+
+    // copies share the pending results, no value is copied
+    auto it = x.begin();
+    tracked::copies = 0;
+    std::vector<decltype(it)> copies(100, it);
+    auto post = it++;
+    EXPECT_EQ(tracked::copies, 0);
+
+    // and every copy keeps its own position, even after the original moves on
+    ++it;
+    ++it;
+    EXPECT_EQ((*post).v, 30);
+    EXPECT_EQ((*it).v, 20);
+    EXPECT_EQ((*copies.back()).v, 30);
+    ++copies.back();
+    EXPECT_EQ((*copies.back()).v, 31);
+    EXPECT_EQ((*copies.front()).v, 30);
+
+    // the copies stay valid when the original is gone
+    decltype(it) last = x.begin();
+    {
+        auto tmp = x.begin();
+        ++tmp;
+        last = tmp;
+    }
+    EXPECT_EQ((*last).v, 31);
+
+    std::vector<int> values;
+    for (auto i = x.begin(); i != x.end(); i++) values.push_back((*i).v);
+    EXPECT_THAT(values, ElementsAre(30,31,32,20,21));
+}
+
+// the digits of each number, least significant first
+static auto digits = [](int v, auto& emit){
+    do {
+        emit(char('0' + v%10));
+        v /= 10;
+    } while (v > 0);
+};
+
+TEST(Demux, emit){
+
+    std::vector<int> v{0,12,345};
+    auto x = func::demux_emit<char>(digits, v);
+
+    std::vector<char> res(x.begin(), x.end());
+    EXPECT_THAT(res, ElementsAre('0','2','1','5','4','3'));
+    EXPECT_THAT(func::collect(x), ElementsAre('0','2','1','5','4','3'));
+
+    // elements emitting nothing are skipped, also typed functors
+    auto y = func::demux_emit<int>([](int v, func::emitter<int>& emit){
+        for (int i = 0; i < v; ++i) emit(v);
+    }, std::vector<int>{0,2,0,0,1,0});
+    EXPECT_THAT(std::vector<int>(y.begin(), y.end()), ElementsAre(2,2,1));
+
+    std::vector<int> none;
+    auto z = func::demux_emit<char>(digits, none);
+    EXPECT_EQ(z.begin(), z.end());
+}
+
+TEST(Demux, emit_allocations){
+
+    std::vector<int> v(10000);
+    for (unsigned i = 0; i < v.size(); ++i) v[i] = i * 7919;
+
+    using alloc = counting_allocator<char>;
+
+    // the buffer grows to the largest expansion and is reused afterwards
+    auto x = func::demux_emit<char, alloc>(digits, v);
+    std::size_t count = 0;
+    alloc::allocations = 0;
+    for (auto it = x.begin(); it != x.end(); ++it) ++count;
+    EXPECT_LT(alloc::allocations, 16);
+
+    // the iterator kept by the postfix increment does not cost a new buffer
+    alloc::allocations = 0;
+    std::size_t post = 0;
+    for (auto it = x.begin(); it != x.end(); it++) ++post;
+    EXPECT_LT(alloc::allocations, 16);
+    EXPECT_EQ(post, count);
+
+    alloc::allocations = 0;
+    std::size_t visited = 0;
+    func::for_each(x, [&](char){ ++visited; });
+    EXPECT_LT(alloc::allocations, 16);
+    EXPECT_EQ(visited, count);
+
+    // returning a collection costs (at least) one per element
+    auto y = func::demux([](int v){
+        std::vector<char, alloc> res;
+        auto emit = [&](char c){ res.push_back(c); };
+        digits(v, emit);
+        return res;
+    }, v);
+    alloc::allocations = 0;
+    for (auto it = y.begin(); it != y.end(); ++it) --count;
+    EXPECT_GE(std::size_t(alloc::allocations), v.size());
+    EXPECT_EQ(count, 0u);
+}
+
+// up to one letter per order of magnitude
+static auto classify = [](int v){
+    func::static_vector<char, 4> res;
+    if (v >1000) res.push_back('d');
+    if (v >100) res.push_back('c');
+    if (v >10) res.push_back('b');
+    if ( v >0) res.push_back('a');
+    return res;
+};
+
+TEST(Demux, inline_results){
+
+    func::static_vector<int, 3> sv {1, 2};
+    sv.push_back(3);
+    EXPECT_EQ(sv.size(), 3u);
+    EXPECT_EQ(sv.capacity(), 3u);
+    EXPECT_THAT(std::vector<int>(sv.begin(), sv.end()), ElementsAre(1,2,3));
+    sv.clear();
+    EXPECT_TRUE(sv.empty());
+
+    std::vector<int> v{1,23,0,456,7890};
+    auto x = func::demux<4>(classify, v);
+
+    ASSERT_TRUE ((std::is_same<decltype(x)::iterator::local_collection, func::static_vector<char, 4>>()));
+    std::string res(x.begin(), x.end());
+    EXPECT_EQ(res, "abacbadcba");
+    EXPECT_EQ(func::collect<std::string>(x), "abacbadcba");
+
+    // the results live in the iterator itself, nothing is allocated for them
+    for (auto i = x.begin(); i != x.end(); ++i){
+        auto p = reinterpret_cast<const char*>(i.local_s);
+        auto b = reinterpret_cast<const char*>(&i);
+        ASSERT_TRUE(b <= p && p < b + sizeof(i));
+    }
+
+    // copies take the results with them, and keep their position
+    auto it = x.begin();
+    ++it;
+    auto cpy = it;
+    ++it;
+    EXPECT_EQ(*cpy, 'b');
+    EXPECT_EQ(*it, 'a');
+    ++cpy;
+    EXPECT_EQ(*cpy, 'a');
+    {
+        auto tmp = x.begin();
+        cpy = tmp;
+    }
+    EXPECT_EQ(*cpy, 'a');
+    EXPECT_EQ(*++cpy, 'b');
+
+    std::vector<int> many(10000);
+    for (unsigned i = 0; i < many.size(); ++i) many[i] = i;
+    auto y = func::demux<4>(classify, many);
+    EXPECT_EQ(func::parallel_collect(y), std::vector<char>(y.begin(), y.end()));
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+class BenchmarkDemuxTest : public ::testing::Test {
+protected:
+    const unsigned BenchmarkSize = 4 * 1024 * 1024;
+
+    std::vector<int> input;
+
+    virtual void SetUp() {
+
+        std::mt19937 gen(11);
+        std::uniform_int_distribution<int> dist(0, 999999);
+
+        input.resize(BenchmarkSize);
+        for (auto& x : input) x = dist(gen);
+    }
+};
+
+TEST_F(BenchmarkDemuxTest, collections){
+
+    using alloc = counting_allocator<char>;
+    auto x = func::demux([](int v){
+        std::vector<char, alloc> res;
+        func::emitter<char, alloc> emit(res);
+        digits(v, emit);
+        return res;
+    }, input);
+
+    alloc::allocations = 0;
+    long sum = 0;
+    func::for_each(x, [&](char c){ sum += c; });
+    EXPECT_GT(sum, 0);
+    // one allocation per element, at least
+    EXPECT_GE(std::size_t(alloc::allocations), input.size());
+}
+
+TEST_F(BenchmarkDemuxTest, emit){
+
+    using alloc = counting_allocator<char>;
+    auto x = func::demux_emit<char, alloc>(digits, input);
+
+    alloc::allocations = 0;
+    long sum = 0;
+    func::for_each(x, [&](char c){ sum += c; });
+    EXPECT_GT(sum, 0);
+    // none per element, only while the buffer grows to the largest expansion
+    EXPECT_LT(alloc::allocations, 16);
+}
+
+// the functor returns up to 4 values kept inside the iterator
+TEST_F(BenchmarkDemuxTest, inline_results){
+
+    auto x = func::demux<4>(classify, input);
+
+    long sum = 0;
+    func::for_each(x, [&](char c){ sum += c; });
+    EXPECT_GT(sum, 0);
+}
+
+TEST_F(BenchmarkDemuxTest, hand_written){
+
+    long sum = 0;
+    for (int v : input){
+        if (v >1000) sum += 'd';
+        if (v >100) sum += 'c';
+        if (v >10) sum += 'b';
+        if ( v >0) sum += 'a';
+    }
+    EXPECT_GT(sum, 0);
+}
@@ -25,9 +25,13 @@
 #include <vector>
 #include <map>
 #include <list>
+#include <string>
+#include <random>
 
 
+#include "transform.h"
 #include "filter.h"
+#include "reduce.h"
 
 using namespace testing;
 
@@ -89,3 +93,144 @@ TEST(Filter, empty){
     std::vector<int> res (x.begin(), x.end());
     EXPECT_EQ(res.size(), 0);
 }
+
+TEST(Filter, single_evaluation){
+
+    std::vector<int> v;
+    for (int i =0;i<100;i++) v.push_back(i);
+
+    // the transform runs once per element, survivors are not recomputed
+    int calls = 0;
+    auto x = func::filter([](int a) { return a%3 == 0; },
+             func::transform([&](int a) { ++calls; return a*2; }, v));
+
+    std::vector<int> res (x.begin(), x.end());
+    EXPECT_EQ(res.size(), 34);
+    EXPECT_EQ(calls, 100);
+
+    // nested filters share the same guarantee
+    calls = 0;
+    auto y = func::filter([](int a) { return a%2 == 0; },
+             func::filter([](int a) { return a%3 == 0; },
+             func::transform([&](int a) { ++calls; return a; }, v)));
+
+    std::vector<int> res2 (y.begin(), y.end());
+    EXPECT_EQ(res2.size(), 17);
+    EXPECT_EQ(calls, 100);
+}
+
+TEST(Filter, copies_keep_value){
+
+    std::map<int, int> m {{1,1},{2,3},{4,4}};
+    auto x = func::filter([](const std::pair<const int,int>& p) { return p.first == p.second; }, m);
+
+    auto it = x.begin();
+    auto cpy = it;
+    ++it;
+    EXPECT_EQ((*cpy).first, 1);
+    EXPECT_EQ((*it).first, 4);
+    ++it;
+    EXPECT_EQ(it, x.end());
+}
+
+TEST(Filter, filter_map){
+
+    std::vector<int> v;
+    for (int i =0;i<20;i++) v.push_back(i);
+
+    // every stage runs once per element, over the source iterator
+    int maps = 0, preds = 0, last = 0;
+    auto x = func::transform([&](int a) { ++last; return std::to_string(a); },
+             func::filter([&](int a) { ++preds; return a%3 == 0; },
+             func::transform([&](int a) { ++maps; return a+1; }, v)));
+
+    using iter = decltype(x.begin());
+    static_assert(std::is_same<iter::source_type, std::vector<int>::iterator>(), "fused with the source");
+
+    std::vector<std::string> res (x.begin(), x.end());
+    EXPECT_THAT(res, ElementsAre("3","6","9","12","15","18"));
+    EXPECT_EQ(maps, 20);
+    EXPECT_EQ(preds, 20);
+    EXPECT_EQ(last, 6);
+}
+
+TEST(Filter, filter_map_nesting){
+
+    std::list<int> l;
+    for (int i =0;i<30;i++) l.push_back(i);
+
+    // the first element of a nested filter is only checked by the outer stages
+    int inner = 0;
+    auto x = func::filter([](int a) { return a%20 == 0; },
+             func::transform([](int a) { return a*10; },
+             func::filter([&](int a) { ++inner; return a%3 == 0; }, l)));
+
+    std::vector<int> res (x.begin(), x.end());
+    EXPECT_THAT(res, ElementsAre(0,60,120,180,240));
+    EXPECT_EQ(inner, 30);
+
+    auto y = func::filter([](int a) { return a > 100; },
+             func::filter([](int a) { return a%2 == 1; }, l));
+    EXPECT_EQ(y.begin(), y.end());
+
+    std::list<int> empty;
+    auto z = func::transform([](int a) { return a; }, func::filter([](int) { return true; }, empty));
+    EXPECT_EQ(z.begin(), z.end());
+}
+
+TEST(Filter, filter_map_copies){
+
+    std::map<int, int> m {{1,1},{2,3},{4,4},{5,6}};
+    auto x = func::transform([](const std::pair<const int,int>& p) { return p.first*2; },
+             func::filter([](const std::pair<const int,int>& p) { return p.first == p.second; }, m));
+
+    auto it = x.begin();
+    auto cpy = it;
+    ++it;
+    EXPECT_EQ(*cpy, 2);
+    EXPECT_EQ(*it, 8);
+    ++it;
+    EXPECT_EQ(it, x.end());
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+class BenchmarkFilterTest : public ::testing::Test {
+protected:
+    const unsigned BenchmarkSize = 4 * 1024 * 1024;
+    const unsigned Repetitions = 10;
+
+    std::vector<int> input;
+
+    virtual void SetUp() {
+
+        std::mt19937 gen(7);
+        std::uniform_int_distribution<int> dist(0, 999);
+
+        input.resize(BenchmarkSize);
+        for (auto& x : input) x = dist(gen);
+    }
+};
+
+// half of the elements survive, the branch of each one can not be predicted
+TEST_F(BenchmarkFilterTest, elements){
+
+    auto x = func::filter([](int a){ return a < 500; }, input);
+
+    long sum = 0;
+    for (unsigned rep = 0; rep < Repetitions; ++rep){
+        for (auto it = x.begin(); it != x.end(); ++it) sum += *it;
+    }
+    EXPECT_GT(sum, 0);
+}
+
+TEST_F(BenchmarkFilterTest, blocks){
+
+    auto x = func::filter([](int a){ return a < 500; }, input);
+
+    long sum = 0;
+    for (unsigned rep = 0; rep < Repetitions; ++rep){
+        sum += func::reduce([](long s, int a){ return s + a; }, x, 0L);
+    }
+    EXPECT_GT(sum, 0);
+}
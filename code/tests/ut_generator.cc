@@ -22,6 +22,7 @@
 #include <iostream>
 #include <vector>
 #include <list>
+#include <limits>
 
 #include "generator.h"
 
@@ -95,3 +96,19 @@ TEST(Generator, Limited_Sequence_Methods){
     EXPECT_EQ(*(it), 2);
     EXPECT_EQ(*(it-1), 1);
 }
+
+TEST(Generator, Unbounded_Sequence_Distance){
+
+    auto x = func::sequence(0, 1);
+    auto b = x.begin();
+
+    EXPECT_EQ((b+1000) - b, 1000);
+    EXPECT_EQ(b - (b+1000), -1000);
+    EXPECT_EQ(*(b+1000), 1000);
+    EXPECT_EQ(b[1000], 1000);
+
+    // as far as a ptrdiff can tell
+    EXPECT_EQ(x.end() - b, std::numeric_limits<std::ptrdiff_t>::max());
+    EXPECT_EQ(b - x.end(), -std::numeric_limits<std::ptrdiff_t>::max());
+    EXPECT_TRUE(b < x.end());
+}
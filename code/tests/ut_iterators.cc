@@ -23,12 +23,29 @@
 #include <list>
 #include <map>
 #include <array>
+#include <string>
+#include <algorithm>
+#include <numeric>
 
 #include "detail/utils.h"
 #include "detail/iterators.h"
 #include "transform.h"
 #include "filter.h"
 #include "zip.h"
+#include "generator.h"
+#include "mux.h"
+#include "demux.h"
+#include "reduce.h"
+#include "parallel.h"
+
+// libstdc++ runs the parallel algorithms on TBB when it is installed, the test needs to link it then
+#if __cplusplus >= 201703L && __has_include(<execution>)
+#include <execution>
+#include <numeric>
+#if !defined(_PSTL_PAR_BACKEND_TBB) || defined(FUNC_LINK_TBB)
+#define FUNC_TEST_EXECUTION
+#endif
+#endif
 
 template<typename T>
 class my_iter: public std::iterator<std::forward_iterator_tag, T>{
@@ -130,9 +147,10 @@ TEST (Iterators, parallel_iterator) {
     using transform_par = func::it::TransformIterator<int,vec::iterator,std::function<int(int)>>;
     using transform_no_par = func::it::TransformIterator<int,list::iterator,std::function<int(int)>>;
 
-    ASSERT_TRUE( (std::is_same< transform_par::iterator_category, std::input_iterator_tag>()) );
-    ASSERT_TRUE( (std::is_same< transform_par::iterator::iterator_category, std::input_iterator_tag>()) );
-    ASSERT_TRUE( (std::is_same< std::iterator_traits<transform_par>::iterator_category, std::input_iterator_tag>()) );
+    ASSERT_TRUE( (std::is_same< transform_par::iterator_category, std::random_access_iterator_tag>()) );
+    ASSERT_TRUE( (std::is_same< transform_par::iterator::iterator_category, std::random_access_iterator_tag>()) );
+    ASSERT_TRUE( (std::is_same< std::iterator_traits<transform_par>::iterator_category, std::random_access_iterator_tag>()) );
+    ASSERT_TRUE( (std::is_same< std::iterator_traits<transform_no_par>::iterator_category, std::input_iterator_tag>()) );
 
     ASSERT_TRUE(transform_par::is_parallel_iterator);
     ASSERT_FALSE(transform_no_par::is_parallel_iterator);
@@ -166,3 +184,148 @@ TEST (Iterators, parallel_iterator) {
     ASSERT_FALSE(zip_no_par_two::is_parallel_iterator);
 
 }
+
+TEST (Iterators, random_access) {
+
+    std::vector<int> v {1, 3, 5, 7, 9, 11};
+    std::list<int> l {1, 3, 5};
+
+    auto t = func::transform([](int x) { return x*2; }, v);
+    auto z = func::zip(v, t);
+    auto q = func::sequence(0, 3, 10);
+
+    using zip_it = decltype(z.begin());
+    using seq_it = decltype(q.begin());
+    EXPECT_TRUE( (std::is_same< std::iterator_traits<zip_it>::iterator_category, std::random_access_iterator_tag>()) );
+    EXPECT_TRUE( (std::is_same< std::iterator_traits<seq_it>::iterator_category, std::random_access_iterator_tag>()) );
+    EXPECT_TRUE( (std::is_same< std::iterator_traits<decltype(func::zip(v, l).begin())>::iterator_category, std::input_iterator_tag>()) );
+
+    // semiregular
+    decltype(t.begin()) it;
+    it = t.begin();
+    it += 2;
+    EXPECT_EQ(*it, 10);
+    it -= 1;
+    EXPECT_EQ(*it, 6);
+    EXPECT_EQ(*(1 + it), 10);
+    EXPECT_EQ(it[2], 14);
+    EXPECT_EQ(*--it, 2);
+    EXPECT_TRUE(it < t.end());
+    EXPECT_TRUE(t.end() > it);
+    EXPECT_TRUE(it <= t.begin());
+    EXPECT_TRUE(it >= t.begin());
+
+    // constant time distance and binary search
+    EXPECT_EQ(std::distance(t.begin(), t.end()), 6);
+    EXPECT_EQ(std::distance(t.end(), t.begin()), -6);
+    EXPECT_EQ(*std::lower_bound(t.begin(), t.end(), 13), 14);
+    EXPECT_TRUE(std::is_sorted(t.begin(), t.end()));
+    EXPECT_EQ(std::distance(q.begin(), std::lower_bound(q.begin(), q.end(), 13)), 5);
+
+    std::reverse_iterator<decltype(t.begin())> r(t.end());
+    EXPECT_EQ(*r, 22);
+
+    zip_it zi;
+    zi = z.begin() + 3;
+    EXPECT_EQ((*zi).second, 14);
+    EXPECT_EQ(z.end() - z.begin(), 6);
+    EXPECT_EQ(z.begin() - z.end(), -6);
+    EXPECT_TRUE(zi < z.end());
+    EXPECT_TRUE(z.begin() < zi);
+    EXPECT_FALSE(zi == z.begin());
+    EXPECT_EQ((*--zi).first, 5);
+
+    // only the elements of the shortest collection are visited
+    std::vector<int> shorter {1, 2};
+    auto zs = func::zip(v, shorter);
+    EXPECT_EQ(zs.end() - zs.begin(), 2);
+    EXPECT_TRUE(zs.begin() + 2 == zs.end());
+    EXPECT_FALSE(zs.begin() + 2 < zs.end());
+
+    std::vector<int> sorted(t.begin(), t.end());
+    std::sort(sorted.begin(), sorted.end(), std::greater<int>());
+    EXPECT_EQ(sorted.front(), 22);
+
+#ifdef FUNC_TEST_EXECUTION
+    auto sum = std::transform_reduce(std::execution::par, t.begin(), t.end(), 0, std::plus<int>(), [](int x) { return x+1; });
+    EXPECT_EQ(sum, 78);
+#endif
+}
+
+// drains a chain through the block protocol, with blocks of the given size
+template <typename C>
+std::vector<func::detail::chain_value_t<C>> by_blocks(C& c, std::size_t n){
+    using value = func::detail::chain_value_t<C>;
+    std::vector<value> res;
+    std::vector<value> block(n);
+    auto it = c.begin();
+    auto end = c.end();
+    while (std::size_t m = func::detail::next_block(it, end, block.data(), n)){
+        EXPECT_LE(m, n);
+        res.insert(res.end(), block.begin(), block.begin() + m);
+    }
+    EXPECT_EQ(func::detail::next_block(it, end, block.data(), n), 0u);
+    return res;
+}
+
+TEST (Iterators, blocks) {
+
+    std::vector<int> v(100);
+    std::iota(v.begin(), v.end(), 0);
+    std::list<int> l(v.begin(), v.end());
+
+    auto t = func::transform([](int x) { return x*2; }, v);
+    auto tl = func::transform([](int x) { return x*2; }, l);
+    auto f = func::filter([](int x) { return x % 3 == 0; }, v);
+    auto fm = func::transform([](int x) { return x+1; }, func::filter([](int x) { return x % 3 == 0; }, v));
+    auto ff = func::filter([](int x) { return x > 50; }, func::transform([](int x) { return x*2; }, v));
+    auto q = func::sequence(0, 3, 40);
+    auto z = func::zip(v, t);
+    auto zl = func::zip(l, v);
+
+    using it_t = std::list<int>::iterator;
+    auto x = func::mux([](it_t& it, const it_t& end) { int s = *it++; if (it != end) s += *it++; return s; }, l);
+    auto d = func::demux([](int x) { return std::vector<int>(x % 4, x); }, v);
+
+    for (std::size_t n : {1u, 3u, 7u, 64u, 1000u}){
+        EXPECT_EQ(by_blocks(t, n), std::vector<int>(t.begin(), t.end()));
+        EXPECT_EQ(by_blocks(tl, n), std::vector<int>(tl.begin(), tl.end()));
+        EXPECT_EQ(by_blocks(f, n), std::vector<int>(f.begin(), f.end()));
+        EXPECT_EQ(by_blocks(fm, n), std::vector<int>(fm.begin(), fm.end()));
+        EXPECT_EQ(by_blocks(ff, n), std::vector<int>(ff.begin(), ff.end()));
+        EXPECT_EQ(by_blocks(q, n), std::vector<int>(q.begin(), q.end()));
+        EXPECT_EQ(by_blocks(z, n), (std::vector<std::pair<int,int>>(z.begin(), z.end())));
+        EXPECT_EQ(by_blocks(zl, n), (std::vector<std::pair<int,int>>(zl.begin(), zl.end())));
+        EXPECT_EQ(by_blocks(x, n), std::vector<int>(x.begin(), x.end()));
+        EXPECT_EQ(by_blocks(d, n), std::vector<int>(d.begin(), d.end()));
+    }
+
+    // the terminal operations consume the chains in blocks
+    EXPECT_TRUE(func::detail::is_block_chain<decltype(f)>::value);
+    EXPECT_FALSE(func::detail::is_block_chain<std::vector<int>>::value);
+    EXPECT_EQ(func::collect(f), std::vector<int>(f.begin(), f.end()));
+    EXPECT_EQ(func::reduce([](int a, int b) { return a+b; }, f, 0), 1683);
+    int sum = 0;
+    func::for_each(d, [&](int x) { sum += x; });
+    EXPECT_EQ(sum, func::reduce([](int a, int b) { return a+b; }, d, 0));
+
+    // an empty source yields no block
+    std::vector<int> none;
+    auto fe = func::filter([](int x) { return x > 0; }, none);
+    EXPECT_TRUE(by_blocks(fe, 4).empty());
+}
+
+TEST (Iterators, cached_value) {
+
+    func::detail::cached_value<std::string> c;
+    c.emplace("value");
+
+    auto& same = c;
+    c = same;
+    ASSERT_TRUE(c.has_value());
+    EXPECT_EQ(c.get(), "value");
+
+    c = std::move(same);
+    ASSERT_TRUE(c.has_value());
+    EXPECT_EQ(c.get(), "value");
+}
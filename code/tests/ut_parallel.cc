@@ -0,0 +1,503 @@
+/**
+	FunctionalCpp,  A header only library for chainable functional operations
+	in C++ collections
+    Copyright (C) 2016 Luis F. Ayuso & Stefan Moosbrugger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include <iostream>
+#include <functional>
+#include <vector>
+#include <list>
+#include <atomic>
+#include <numeric>
+
+#include <random>
+
+#include "transform.h"
+#include "filter.h"
+#include "demux.h"
+#include "zip.h"
+#include "generator.h"
+#include "reduce.h"
+#include "parallel.h"
+
+using namespace testing;
+
+TEST(Parallel, traits){
+
+    std::vector<int> v(10);
+    std::list<int> l(10);
+
+    auto a = func::transform([](int x) -> float { return x+0.5; }, v);
+    auto b = func::transform([](float x) -> int { return x*2; }, a);
+    auto c = func::transform([](int x) -> float { return x+0.5; }, l);
+    auto d = func::filter([](int x) { return x > 0; }, v);
+
+    EXPECT_TRUE(func::detail::is_parallel_chain<decltype(a)>::value);
+    EXPECT_TRUE(func::detail::is_parallel_chain<decltype(b)>::value);
+    EXPECT_FALSE(func::detail::is_parallel_chain<decltype(c)>::value);
+    EXPECT_FALSE(func::detail::is_parallel_chain<decltype(d)>::value);
+}
+
+TEST(Parallel, collect){
+
+    std::vector<float> v(100000);
+    for (unsigned i = 0; i < v.size(); ++i) v[i] = i;
+
+    auto x = func::transform([](float a){ return a*2; },
+             func::transform([](float a){ return a+1; }, v));
+
+    auto res = func::parallel_collect(x);
+    ASSERT_EQ(res.size(), v.size());
+    for (unsigned i = 0; i < v.size(); ++i){
+        ASSERT_FLOAT_EQ(res[i], (v[i]+1)*2);
+    }
+}
+
+TEST(Parallel, collect_small){
+
+    std::vector<int> v {1,2,3};
+    auto res = func::parallel_collect(func::transform([](int a){ return a*2; }, v));
+    EXPECT_THAT(res, ElementsAre(2,4,6));
+
+    std::vector<int> e;
+    auto res2 = func::parallel_collect(func::transform([](int a){ return a*2; }, e));
+    EXPECT_TRUE(res2.empty());
+}
+
+TEST(Parallel, collect_sequential){
+
+    std::list<int> l {1,2,3,4};
+    auto res = func::parallel_collect(func::transform([](int a){ return a*2; }, l));
+    EXPECT_THAT(res, ElementsAre(2,4,6,8));
+
+    std::vector<int> v {1,2,3,4};
+    auto res2 = func::parallel_collect(func::filter([](int a){ return a%2; }, v));
+    EXPECT_THAT(res2, ElementsAre(1,3));
+}
+
+TEST(Parallel, collect_sequence){
+
+    auto x = func::transform([](int a){ return a*2; }, func::sequence(0, 1, 1000));
+    auto res = func::parallel_collect(x);
+    ASSERT_EQ(res.size(), 1000);
+    for (int i = 0; i < 1000; ++i){
+        ASSERT_EQ(res[i], i*2);
+    }
+}
+
+TEST(Parallel, collect_zip){
+
+    std::vector<int> a (5000);
+    std::vector<float> b (4000);
+    for (unsigned i = 0; i < a.size(); ++i) a[i] = i;
+    for (unsigned i = 0; i < b.size(); ++i) b[i] = i*0.5;
+
+    auto res = func::parallel_collect(func::zip(a, b));
+    ASSERT_EQ(res.size(), 4000);
+    for (unsigned i = 0; i < res.size(); ++i){
+        ASSERT_EQ(res[i].first, i);
+        ASSERT_FLOAT_EQ(res[i].second, i*0.5);
+    }
+}
+
+TEST(Parallel, collect_unbounded_zip){
+
+    std::vector<long> v (100000);
+    for (unsigned i = 0; i < v.size(); ++i) v[i] = i*2;
+
+    // the vector bounds the unbounded sequence, whichever comes first
+    auto res = func::parallel_collect(func::zip(func::sequence(0, 1), v));
+    ASSERT_EQ(res.size(), v.size());
+    for (unsigned i = 0; i < res.size(); ++i){
+        ASSERT_EQ(res[i].first, i);
+        ASSERT_EQ(res[i].second, i*2);
+    }
+
+    auto sum = func::reduce(func::par, [](long a, long b) { return a+b; },
+                            func::transform([](const std::pair<long,int>& p) { return p.first+p.second; },
+                                            func::zip(v, func::sequence(0, 1))), 0l);
+    EXPECT_EQ(sum, 3l*(v.size()*(v.size()-1)/2));
+}
+
+TEST(Parallel, for_each){
+
+    std::vector<int> v(100000, 1);
+    std::atomic<long> sum(0);
+
+    func::parallel_for_each(func::transform([](int a){ return a+1; }, v), [&](int x){
+        sum += x;
+    });
+    EXPECT_EQ(sum, 200000);
+
+    std::list<int> l(100, 1);
+    sum = 0;
+    func::parallel_for_each(func::transform([](int a){ return a+1; }, l), [&](int x){
+        sum += x;
+    });
+    EXPECT_EQ(sum, 200);
+}
+
+TEST(Parallel, filter_traits){
+
+    std::vector<int> v(10);
+    std::list<int> l(10);
+
+    auto a = func::filter([](int x) { return x > 0; }, v);
+    auto b = func::filter([](int x) { return x > 0; }, func::transform([](int x) { return x-1; }, v));
+    auto c = func::filter([](int x) { return x > 0; }, l);
+    auto d = func::filter([](int x) { return x > 0; }, func::filter([](int x) { return x > 0; }, v));
+
+    EXPECT_TRUE(func::detail::is_parallel_filter<decltype(a)>::value);
+    EXPECT_TRUE(func::detail::is_parallel_filter<decltype(b)>::value);
+    EXPECT_FALSE(func::detail::is_parallel_filter<decltype(c)>::value);
+    // nested filters are fused, the innermost source is accessed in parallel
+    EXPECT_TRUE(func::detail::is_parallel_filter<decltype(d)>::value);
+}
+
+TEST(Parallel, collect_filter){
+
+    std::vector<int> v(100000);
+    for (unsigned i = 0; i < v.size(); ++i) v[i] = i;
+
+    auto x = func::filter([](int a){ return a%3 == 0; },
+             func::transform([](int a){ return a+1; }, v));
+
+    auto res = func::parallel_collect(x);
+    std::vector<int> expected (x.begin(), x.end());
+    ASSERT_EQ(res.size(), expected.size());
+    EXPECT_EQ(res, expected);
+}
+
+TEST(Parallel, collect_filter_edges){
+
+    std::vector<int> v(10000, 1);
+
+    auto none = func::parallel_collect(func::filter([](int a){ return a > 1; }, v));
+    EXPECT_TRUE(none.empty());
+
+    auto all = func::parallel_collect(func::filter([](int a){ return a == 1; }, v));
+    EXPECT_EQ(all.size(), v.size());
+
+    // survivors only at the very end
+    v.back() = 2;
+    auto last = func::parallel_collect(func::filter([](int a){ return a > 1; }, v));
+    EXPECT_THAT(last, ElementsAre(2));
+
+    std::vector<int> small {1,2,3,4,5};
+    auto odd = func::parallel_collect(func::filter([](int a){ return a%2; }, small));
+    EXPECT_THAT(odd, ElementsAre(1,3,5));
+}
+
+TEST(Parallel, collect_filter_map){
+
+    std::vector<int> v(100000);
+    for (unsigned i = 0; i < v.size(); ++i) v[i] = i;
+
+    // fused stages, the innermost vector is split
+    auto x = func::transform([](int a){ return a*2; },
+             func::filter([](int a){ return a%3 == 0; },
+             func::transform([](int a){ return a+1; }, v)));
+    EXPECT_TRUE(func::detail::is_parallel_filter<decltype(x)>::value);
+
+    auto res = func::parallel_collect(x);
+    std::vector<int> expected (x.begin(), x.end());
+    EXPECT_EQ(res, expected);
+    EXPECT_EQ(res.front(), 6);
+
+    std::atomic<long> count(0);
+    func::parallel_for_each(func::filter([](int a){ return a%2; }, func::filter([](int a){ return a%5 == 0; }, v)), [&](int){
+        ++count;
+    });
+    EXPECT_EQ(count, 10000);
+
+    // the first survivor is not evaluated twice
+    std::atomic<int> calls(0);
+    std::vector<int> small {1,2,3,4,5};
+    auto y = func::filter([](int a){ return a%2; }, func::transform([&](int a){ ++calls; return a; }, small));
+    EXPECT_THAT(func::parallel_collect(y), ElementsAre(1,3,5));
+    EXPECT_EQ(calls, 5);
+}
+
+TEST(Parallel, for_each_filter){
+
+    std::vector<int> v(100000, 1);
+    for (unsigned i = 0; i < v.size(); i+=2) v[i] = 2;
+    std::atomic<long> sum(0);
+
+    func::parallel_for_each(func::filter([](int a){ return a == 2; }, v), [&](int x){
+        sum += x;
+    });
+    EXPECT_EQ(sum, 100000);
+}
+
+TEST(Parallel, demux_traits){
+
+    std::vector<int> v(10);
+    std::list<int> l(10);
+
+    auto a = func::demux([](int x) { return std::vector<int>(x, x); }, v);
+    auto b = func::demux([](int x) { return std::vector<int>(x, x); }, l);
+
+    EXPECT_TRUE(func::detail::is_parallel_demux<decltype(a)>::value);
+    EXPECT_FALSE(func::detail::is_parallel_demux<decltype(b)>::value);
+    EXPECT_FALSE(func::detail::is_parallel_chain<decltype(a)>::value);
+}
+
+TEST(Parallel, collect_demux){
+
+    std::vector<int> v(20000);
+    for (unsigned i = 0; i < v.size(); ++i) v[i] = i;
+
+    // uneven expansion, some elements produce nothing
+    auto x = func::demux([](int a) {
+                std::vector<int> r;
+                for (int i = 0; i < a%5; ++i) r.push_back(a*10 + i);
+                return r;
+             },
+             func::transform([](int a){ return a+1; }, v));
+
+    auto res = func::parallel_collect(x);
+    std::vector<int> expected (x.begin(), x.end());
+    ASSERT_EQ(res.size(), expected.size());
+    EXPECT_EQ(res, expected);
+}
+
+TEST(Parallel, collect_demux_edges){
+
+    std::vector<int> v(10000, 1);
+
+    auto none = func::parallel_collect(func::demux([](int){ return std::vector<int>(); }, v));
+    EXPECT_TRUE(none.empty());
+
+    // only the last one expands
+    v.back() = 3;
+    auto last = func::parallel_collect(func::demux([](int a){ return std::vector<int>(a == 3? a: 0, a); }, v));
+    EXPECT_THAT(last, ElementsAre(3,3,3));
+
+    std::vector<int> small {1,2};
+    auto few = func::parallel_collect(func::demux([](int a){ return std::vector<int>(a, a); }, small));
+    EXPECT_THAT(few, ElementsAre(1,2,2));
+}
+
+namespace {
+    // any allocator but the default one
+    template <typename T>
+    struct other_allocator : std::allocator<T> {
+        using value_type = T;
+        other_allocator() = default;
+        template <typename U> other_allocator(const other_allocator<U>&) {}
+        template <typename U> struct rebind { using other = other_allocator<U>; };
+    };
+}
+
+TEST(Parallel, collect_demux_emit){
+
+    std::vector<int> v(20000);
+    for (unsigned i = 0; i < v.size(); ++i) v[i] = i;
+
+    auto x = func::demux_emit<int>([](int a, auto& emit) {
+                for (int i = 0; i < a%5; ++i) emit(a*10 + i);
+             }, v);
+
+    EXPECT_TRUE(func::detail::is_parallel_demux<decltype(x)>::value);
+    auto res = func::parallel_collect(x);
+    std::vector<int> expected (x.begin(), x.end());
+    EXPECT_EQ(res, expected);
+
+    std::atomic<long> sum(0);
+    func::parallel_for_each(x, [&](int a){ sum += a; });
+    EXPECT_EQ(sum, std::accumulate(expected.begin(), expected.end(), 0L));
+
+    // with another allocator the values go through a buffer per part
+    auto y = func::demux_emit<int, other_allocator<int>>([](int a, auto& emit) {
+                for (int i = 0; i < a%5; ++i) emit(a*10 + i);
+             }, v);
+    EXPECT_EQ(func::parallel_collect(y), expected);
+}
+
+TEST(Parallel, for_each_demux){
+
+    std::vector<int> v(10000, 3);
+    std::atomic<long> sum(0);
+
+    func::parallel_for_each(func::demux([](int a){ return std::vector<int>(a, a); }, v), [&](int x){
+        sum += x;
+    });
+    EXPECT_EQ(sum, 90000);
+}
+
+namespace {
+    struct cheap_key {};
+    struct expensive_key {};
+    struct sampled_key {};
+}
+
+TEST(Parallel, cost_model_decision){
+
+    using cheap = func::detail::cost_model<cheap_key>;
+    using expensive = func::detail::cost_model<expensive_key>;
+
+    EXPECT_EQ(cheap::parts_for(1000), 1);
+
+    // 1ns per element, only worth it for long ranges
+    cheap::record(256, 256);
+    EXPECT_EQ(cheap::parts_for(200), 1);
+    EXPECT_GT(cheap::parts_for(10000000), 1);
+
+    // 10us per element, even short ranges are split
+    expensive::record(2560000, 256);
+    EXPECT_GT(expensive::parts_for(200), 1);
+    EXPECT_LE(expensive::parts_for(200), 4);
+    EXPECT_EQ(expensive::parts_for(1), 1);
+}
+
+TEST(Parallel, cost_model_sampling){
+
+    using model = func::detail::cost_model<sampled_key>;
+
+    std::vector<std::pair<std::size_t, std::size_t>> probed;
+    auto probe = [&](std::size_t from, std::size_t to){
+        probed.emplace_back(from, to);
+    };
+
+    // short runs are sampled until a full sample is taken
+    auto a = model::plan(100, probe);
+    EXPECT_EQ(a.head, 100);
+    auto b = model::plan(1000, probe);
+    EXPECT_EQ(b.head, model::sample_size);
+    auto c = model::plan(1000, probe);
+    EXPECT_EQ(c.head, 0);
+
+    ASSERT_EQ(probed.size(), 2);
+    EXPECT_EQ(probed[1].second, model::sample_size);
+    EXPECT_GE(model::ns_per_element(), 0);
+}
+
+TEST(Parallel, cost_model_bounds){
+
+    func::detail::schedule s { 256, 3 };
+    std::size_t n = 10000;
+    EXPECT_EQ(func::detail::part_bound(s, n, 0), 256);
+    EXPECT_EQ(func::detail::part_bound(s, n, 3), n);
+    for (std::size_t p = 1; p < 3; ++p){
+        EXPECT_EQ(func::detail::part_bound(s, n, p) % func::detail::chunk_alignment, 0);
+        EXPECT_LT(func::detail::part_bound(s, n, p-1), func::detail::part_bound(s, n, p));
+    }
+}
+
+TEST(Parallel, expensive_small){
+
+    // short ranges of expensive elements are split as well, results stay in order
+    for (unsigned n : {1u, 200u, 256u, 257u, 1000u}){
+        std::vector<int> v(n);
+        for (unsigned i = 0; i < n; ++i) v[i] = i;
+
+        auto slow = [](int a){
+            volatile int acc = 0;
+            for (int i = 0; i < 20000; ++i) acc = acc + i;
+            return a*2;
+        };
+        auto x = func::transform(slow, v);
+        std::vector<int> expected (x.begin(), x.end());
+        EXPECT_EQ(func::parallel_collect(x), expected);
+
+        auto y = func::filter([](int a){ return a%3 == 0; }, func::transform(slow, v));
+        std::vector<int> expected_filter (y.begin(), y.end());
+        EXPECT_EQ(func::parallel_collect(y), expected_filter);
+    }
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+class BenchmarkParallelTest : public ::testing::Test {
+protected:
+    const unsigned BenchmarkSize = 1024 * 1024;
+
+    std::vector<float> input;
+
+    virtual void SetUp() {
+
+        std::random_device rd;
+        std::uniform_int_distribution<int> dist(0, 999);
+
+        input.resize(BenchmarkSize);
+
+        for (unsigned i = 0; i < BenchmarkSize; ++i){
+            input[i] = dist(rd);
+        }
+    }
+};
+
+TEST_F(BenchmarkParallelTest, sequential){
+
+    auto x = func::transform([](float a){ return a-1; },
+             func::transform([](float a){ return a/4; },
+             func::transform([](float a){ return a*3; },
+             func::transform([](float a){ return a+1; }, input))));
+
+    std::vector<float> res (x.begin(), x.end());
+    EXPECT_EQ(res.size(), BenchmarkSize);
+}
+
+TEST_F(BenchmarkParallelTest, parallel){
+
+    auto x = func::transform([](float a){ return a-1; },
+             func::transform([](float a){ return a/4; },
+             func::transform([](float a){ return a*3; },
+             func::transform([](float a){ return a+1; }, input))));
+
+    auto res = func::parallel_collect(x);
+    EXPECT_EQ(res.size(), BenchmarkSize);
+}
+
+TEST_F(BenchmarkParallelTest, filter_sequential){
+
+    auto x = func::filter([](float a){ return a > 500; },
+             func::transform([](float a){ return a*3; }, input));
+
+    std::vector<float> res (x.begin(), x.end());
+    EXPECT_GT(res.size(), 0);
+}
+
+TEST_F(BenchmarkParallelTest, filter_parallel){
+
+    auto x = func::filter([](float a){ return a > 500; },
+             func::transform([](float a){ return a*3; }, input));
+
+    auto res = func::parallel_collect(x);
+    EXPECT_GT(res.size(), 0);
+}
+
+TEST_F(BenchmarkParallelTest, demux_sequential){
+
+    auto x = func::demux([](float a){ return std::vector<float>{a, a*2, a*3}; },
+             func::transform([](float a){ return a*3; }, input));
+
+    std::vector<float> res (x.begin(), x.end());
+    EXPECT_EQ(res.size(), BenchmarkSize*3);
+}
+
+TEST_F(BenchmarkParallelTest, demux_parallel){
+
+    auto x = func::demux([](float a){ return std::vector<float>{a, a*2, a*3}; },
+             func::transform([](float a){ return a*3; }, input));
+
+    auto res = func::parallel_collect(x);
+    EXPECT_EQ(res.size(), BenchmarkSize*3);
+}
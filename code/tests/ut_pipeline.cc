@@ -0,0 +1,328 @@
+/**
+	FunctionalCpp,  A header only library for chainable functional operations
+	in C++ collections
+    Copyright (C) 2016 Luis F. Ayuso & Stefan Moosbrugger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include <iostream>
+#include <functional>
+#include <vector>
+#include <list>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+#include <chrono>
+#include <ctime>
+
+#include "transform.h"
+#include "filter.h"
+#include "mux.h"
+#include "demux.h"
+#include "pipeline.h"
+
+using namespace testing;
+
+TEST(Pipeline, queue){
+
+    func::detail::spsc_queue<int> q(3);
+    int v = 1;
+    EXPECT_TRUE(q.try_push(v));
+    v = 2; EXPECT_TRUE(q.try_push(v));
+    v = 3; EXPECT_TRUE(q.try_push(v));
+    v = 4; EXPECT_TRUE(q.try_push(v));
+    v = 5; EXPECT_FALSE(q.try_push(v));
+
+    int r;
+    EXPECT_TRUE(q.try_pop(r)); EXPECT_EQ(r, 1);
+    EXPECT_TRUE(q.try_pop(r)); EXPECT_EQ(r, 2);
+    EXPECT_TRUE(q.try_pop(r)); EXPECT_EQ(r, 3);
+    EXPECT_TRUE(q.try_pop(r)); EXPECT_EQ(r, 4);
+    EXPECT_FALSE(q.try_pop(r));
+}
+
+TEST(Pipeline, queue_threads){
+
+    func::detail::spsc_queue<int> q(16);
+    const int N = 100000;
+
+    std::thread producer([&](){
+        for (int i = 0; i < N; ++i){
+            int v = i;
+            while (!q.try_push(v)) std::this_thread::yield();
+        }
+    });
+
+    long sum = 0;
+    int expected = 0;
+    while (expected < N){
+        int r;
+        if (!q.try_pop(r)) { std::this_thread::yield(); continue; }
+        ASSERT_EQ(r, expected);
+        sum += r;
+        ++expected;
+    }
+    producer.join();
+    EXPECT_EQ(sum, long(N)*(N-1)/2);
+}
+
+TEST(Pipeline, stages){
+
+    std::list<int> l {1,2,3,4,5,6};
+
+    auto a = func::transform([](int x) { return x+1; }, l);
+    EXPECT_EQ(func::pipeline(a).stages(), 1);
+
+    auto b = func::filter([](int x) { return x%2; },
+             func::transform([](int x) { return x+1; }, l));
+    EXPECT_EQ(func::pipeline(b).stages(), 2);
+
+    // the functor only accepts the transform iterators, both run together
+    auto t = func::transform([](int x) { return x+1; }, l);
+    using it_t = decltype(t)::iterator;
+    auto c = func::mux([](it_t& it, const it_t&) { return *it++; }, t);
+    EXPECT_EQ(func::pipeline(c).stages(), 1);
+
+    auto d = func::mux([](auto& it, const auto&) { return *it++; },
+             func::transform([](int x) { return x+1; }, l));
+    EXPECT_EQ(func::pipeline(d).stages(), 2);
+}
+
+TEST(Pipeline, transform_filter){
+
+    std::list<int> l;
+    for (int i = 0; i < 10000; ++i) l.push_back(i);
+
+    auto x = func::transform([](int x) { return x*2; },
+             func::filter([](int x) { return x%3 == 0; },
+             func::transform([](int x) { return x+1; }, l)));
+
+    std::vector<int> expected (x.begin(), x.end());
+
+    auto p = func::pipeline(x, 64);
+    EXPECT_EQ(p.stages(), 3);
+    std::vector<int> res (p.begin(), p.end());
+    EXPECT_EQ(res, expected);
+}
+
+TEST(Pipeline, own_threads){
+
+    std::list<int> l (1000, 1);
+    std::thread::id me = std::this_thread::get_id();
+    std::thread::id first, second;
+
+    auto p = func::pipeline(
+                func::transform([&](int x) { second = std::this_thread::get_id(); return x+1; },
+                func::transform([&](int x) { first = std::this_thread::get_id(); return x+1; }, l)));
+
+    std::vector<int> res (p.begin(), p.end());
+    EXPECT_EQ(res.size(), 1000);
+    EXPECT_NE(first, me);
+    EXPECT_NE(second, me);
+    EXPECT_NE(first, second);
+}
+
+TEST(Pipeline, lines){
+
+    std::string text;
+    for (int i = 0; i < 1000; ++i) text += "line " + std::to_string(i) + "\n";
+
+    auto lines = func::mux([](auto& it, const auto& end) -> std::string {
+            std::string ret;
+            while (it != end && *it != '\n') {
+                ret += *it;
+                ++it;
+            }
+            if (it != end) ++it;
+            return ret;
+        }, text);
+
+    auto p = func::pipeline(
+                func::filter([](const std::string& s) { return s[s.size()-2] == '7'; },
+                func::transform([](const std::string& s) -> std::string { return s + "!"; },
+                func::transform([](const std::string& s) -> std::string { return s.substr(5); }, lines))));
+
+    EXPECT_EQ(p.stages(), 4);
+    std::vector<std::string> res (p.begin(), p.end());
+    ASSERT_EQ(res.size(), 100);
+    EXPECT_EQ(res[0], "7!");
+    EXPECT_EQ(res[1], "17!");
+    EXPECT_EQ(res[99], "997!");
+}
+
+TEST(Pipeline, mux_demux){
+
+    std::list<int> l {1,23,456,7890};
+
+    auto x = func::mux([](auto& it, const auto& end) -> int {
+                int sum = 0;
+                for (int i = 0; i < 2 && it != end; ++i, ++it) sum += *it;
+                return sum;
+            },
+            func::demux([](int v) -> std::vector<int> {
+                std::vector<int> digits;
+                for (; v > 0; v /= 10) digits.push_back(v%10);
+                return digits;
+            }, l));
+
+    std::vector<int> expected (x.begin(), x.end());
+    auto p = func::pipeline(x, 1);
+    EXPECT_EQ(p.stages(), 2);
+    std::vector<int> res (p.begin(), p.end());
+    EXPECT_EQ(res, expected);
+    EXPECT_THAT(res, ElementsAre(4,8,9,9,15));
+}
+
+TEST(Pipeline, empty){
+
+    std::list<int> l;
+    auto p = func::pipeline(func::transform([](int x) { return x; }, func::transform([](int x) { return x; }, l)));
+    EXPECT_EQ(p.begin(), p.end());
+}
+
+TEST(Pipeline, cancel){
+
+    std::list<int> l (100000, 1);
+    auto p = func::pipeline(func::transform([](int x) { return x; }, func::transform([](int x) { return x; }, l)), 16);
+
+    auto it = p.begin();
+    for (int i = 0; i < 10; ++i, ++it){
+        ASSERT_EQ(*it, 1);
+    }
+    // destruction stops the stages
+}
+
+TEST(Pipeline, waiting_stages_sleep){
+
+    // the innermost stage is slow, the others wait for it most of the time
+    std::list<int> l (100, 1);
+    auto p = func::pipeline(
+                func::transform([](int x) { return x+1; },
+                func::transform([](int x) { return x+1; },
+                func::transform([](int x) { std::this_thread::sleep_for(std::chrono::milliseconds(2)); return x; }, l))), 1);
+
+    auto wall = std::chrono::steady_clock::now();
+    std::clock_t cpu = std::clock();
+    int sum = 0;
+    for (int x : p) sum += x;
+    double cpu_ms = 1000.0 * (std::clock() - cpu) / CLOCKS_PER_SEC;
+    double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wall).count();
+
+    EXPECT_EQ(sum, 300);
+    // waiting threads which spin take all the time of the cores they run on
+    EXPECT_LT(cpu_ms, wall_ms / 2);
+}
+
+TEST(Pipeline, exception){
+
+    std::list<int> l (10000, 1);
+    auto p = func::pipeline(
+                func::transform([](int x) { return x; },
+                func::transform([](int) -> int { throw std::runtime_error("stage failed"); }, l)));
+
+    EXPECT_THROW(std::vector<int> res (p.begin(), p.end()), std::runtime_error);
+}
+
+TEST(Pipeline, replicate_sequential){
+
+    std::list<int> l {1,2,3,4,5};
+    auto r = func::replicate(4, func::transform([](int x) { return x*10; }, l));
+    std::vector<int> res (r.begin(), r.end());
+    EXPECT_THAT(res, ElementsAre(10,20,30,40,50));
+}
+
+TEST(Pipeline, replicate_order){
+
+    std::list<int> l;
+    for (int i = 0; i < 20000; ++i) l.push_back(i);
+
+    // uneven cost, batches finish out of order
+    auto slow = [](int x) -> int {
+        volatile int acc = 0;
+        for (int i = 0; i < (x/16)%7 * 50; ++i) acc = acc + i;
+        return x*2;
+    };
+
+    auto p = func::pipeline(
+                func::filter([](int x) { return x%3 == 0; },
+                func::replicate(4, func::transform(slow,
+                func::transform([](int x) { return x+1; }, l)))), 16);
+
+    EXPECT_EQ(p.stages(), 3);
+    std::vector<int> res (p.begin(), p.end());
+
+    std::vector<int> expected;
+    for (int i = 0; i < 20000; ++i) if ((i+1)*2 % 3 == 0) expected.push_back((i+1)*2);
+    EXPECT_EQ(res, expected);
+}
+
+TEST(Pipeline, replicate_bounded){
+
+    std::list<int> l;
+    for (int i = 0; i < 100000; ++i) l.push_back(i);
+
+    // the first batch stalls, the other workers can only run ahead as far as their channels allow
+    std::atomic<int> processed(0);
+    auto stall = [&processed](int x) -> int {
+        if (x == 0) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        ++processed;
+        return x;
+    };
+
+    auto p = func::pipeline(func::replicate(4, func::transform(stall, func::transform([](int x) { return x; }, l))), 16);
+
+    auto it = p.begin();
+    EXPECT_EQ(*it, 0);
+    // what fits in the channels of the workers and the output, 8 batches of 16 elements each
+    EXPECT_LT(processed, 1000);
+
+    std::size_t count = 0;
+    for (; it != p.end(); ++it) ++count;
+    EXPECT_EQ(count, l.size());
+}
+
+TEST(Pipeline, replicate_leaf){
+
+    std::list<int> l;
+    for (int i = 0; i < 1000; ++i) l.push_back(i);
+
+    auto p = func::pipeline(func::replicate(3, func::transform([](int x) { return x-1; }, l)), 7);
+    EXPECT_EQ(p.stages(), 1);
+    std::vector<int> res (p.begin(), p.end());
+    ASSERT_EQ(res.size(), 1000);
+    for (int i = 0; i < 1000; ++i) EXPECT_EQ(res[i], i-1);
+}
+
+TEST(Pipeline, replicate_empty){
+
+    std::list<int> l;
+    auto p = func::pipeline(func::replicate(2, func::transform([](int x) { return x; }, l)));
+    EXPECT_EQ(p.begin(), p.end());
+}
+
+TEST(Pipeline, replicate_exception){
+
+    std::list<int> l (10000, 1);
+    auto p = func::pipeline(
+                func::replicate(3, func::transform([](int x) -> int {
+                    if (x) throw std::runtime_error("worker failed");
+                    return x;
+                }, l)));
+
+    EXPECT_THROW(std::vector<int> res (p.begin(), p.end()), std::runtime_error);
+}
@@ -0,0 +1,138 @@
+/**
+	FunctionalCpp,  A header only library for chainable functional operations
+	in C++ collections
+    Copyright (C) 2016 Luis F. Ayuso & Stefan Moosbrugger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "gtest/gtest.h"
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include <vector>
+#include <list>
+#include <string>
+#include <atomic>
+#include <type_traits>
+
+#include "transform.h"
+#include "filter.h"
+#include "mux.h"
+#include "demux.h"
+#include "zip.h"
+#include "reduce.h"
+#include "parallel.h"
+
+using namespace testing;
+
+TEST(Policy, inherited){
+
+    std::vector<int> v(10);
+
+    auto a = func::transform([](int x) { return x+1; }, v);
+    auto b = func::transform(func::par, [](int x) { return x+1; }, v);
+    auto c = func::filter([](int x) { return x > 0; }, func::transform(func::par_unseq, [](int x) { return x+1; }, v));
+    auto d = func::transform(func::seq, [](int x) { return x+1; }, func::transform(func::par, [](int x) { return x+1; }, v));
+
+    EXPECT_TRUE((std::is_same<decltype(a)::policy_type, func::sequenced_policy>::value));
+    EXPECT_TRUE((std::is_same<decltype(b)::policy_type, func::parallel_policy>::value));
+    EXPECT_TRUE((std::is_same<decltype(c)::policy_type, func::parallel_unsequenced_policy>::value));
+    EXPECT_TRUE((std::is_same<decltype(d)::policy_type, func::sequenced_policy>::value));
+}
+
+TEST(Policy, zip){
+
+    std::vector<int> v(10);
+    std::vector<float> w(10);
+
+    auto a = func::zip(v, w);
+    auto b = func::zip(func::transform(func::par, [](int x) { return x+1; }, v), w);
+    auto c = func::zip(func::par, v, w);
+
+    EXPECT_TRUE((std::is_same<decltype(a)::policy_type, func::sequenced_policy>::value));
+    EXPECT_TRUE((std::is_same<decltype(b)::policy_type, func::parallel_policy>::value));
+    EXPECT_TRUE((std::is_same<decltype(c)::policy_type, func::parallel_policy>::value));
+
+    EXPECT_TRUE((std::is_same<func::detail::common_policy_t<func::parallel_policy, func::parallel_unsequenced_policy>, func::parallel_policy>::value));
+    EXPECT_TRUE((std::is_same<func::detail::common_policy_t<func::sequenced_policy, func::parallel_unsequenced_policy>, func::parallel_unsequenced_policy>::value));
+
+    std::vector<std::pair<int, float>> res = func::collect(c);
+    EXPECT_EQ(res.size(), 10);
+}
+
+TEST(Policy, collect){
+
+    std::vector<int> v(100000);
+    for (unsigned i = 0; i < v.size(); ++i) v[i] = i;
+
+    auto x = func::filter([](int a){ return a%3 == 0; },
+             func::transform(func::par, [](int a){ return a+1; }, v));
+
+    std::vector<int> expected (x.begin(), x.end());
+    EXPECT_EQ(func::collect(x), expected);
+    EXPECT_EQ(func::collect(func::seq, x), expected);
+
+    // can not be split, evaluated sequentially
+    std::list<int> l (v.begin(), v.end());
+    auto y = func::transform(func::par, [](int a){ return a+1; }, l);
+    std::vector<int> res = func::collect(y);
+    ASSERT_EQ(res.size(), l.size());
+    EXPECT_EQ(res.back(), 100000);
+}
+
+TEST(Policy, for_each){
+
+    std::vector<int> v(100000, 1);
+
+    std::atomic<long> sum(0);
+    func::for_each(func::transform(func::par, [](int a){ return a*2; }, v), [&](int x){
+        sum += x;
+    });
+    EXPECT_EQ(sum, 200000);
+
+    // sequential, in order
+    std::vector<int> seen;
+    std::vector<int> small {1,2,3};
+    func::for_each(func::transform([](int a){ return a*2; }, small), [&](int x){
+        seen.push_back(x);
+    });
+    EXPECT_THAT(seen, ElementsAre(2,4,6));
+}
+
+TEST(Policy, reduce){
+
+    std::vector<int> v(100000, 1);
+
+    auto x = func::transform(func::par, [](int a){ return a*2; }, v);
+    EXPECT_EQ(func::reduce([](int a, int b){ return a+b; }, x, 0), 200000);
+    EXPECT_EQ(func::reduce(func::seq, [](int a, int b){ return a+b; }, x, 0), 200000);
+    EXPECT_EQ(func::reduce(func::par_unseq, [](int a, int b){ return a+b; }, v, 0), 100000);
+}
+
+TEST(Policy, mux_demux){
+
+    std::vector<int> v {1,2,3,4};
+
+    auto d = func::demux(func::par, [](int a){ return std::vector<int>(a, a); }, v);
+    EXPECT_TRUE((std::is_same<decltype(d)::policy_type, func::parallel_policy>::value));
+    EXPECT_THAT(func::collect(d), ElementsAre(1,2,2,3,3,3,4,4,4,4));
+
+    std::string text ("a,b,c");
+    auto m = func::mux(func::par, [](auto& it, const auto& end) -> char {
+        char c = *it++;
+        if (it != end) ++it;
+        return c;
+    }, text);
+    EXPECT_THAT(func::collect(m), ElementsAre('a','b','c'));
+}
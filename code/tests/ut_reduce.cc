@@ -25,6 +25,7 @@
 #include <list>
 #include <array>
 
+#include "transform.h"
 #include "reduce.h"
 
 using namespace testing;
@@ -62,3 +63,77 @@ TEST(ReduceTest, otherType){
     EXPECT_EQ(res.first, 3);
     EXPECT_FLOAT_EQ(res.second, 0.3);
 }
+
+TEST(ReduceTest, chain){
+    std::vector<float> v(1000);
+    for (unsigned i = 0; i < v.size(); ++i) v[i] = i;
+
+    auto x = func::transform([](float a){ return a*2; }, v);
+
+    float expected = 0;
+    for (auto a : v) expected = expected + a*2;
+    EXPECT_EQ(func::reduce([](float s, float a){ return s+a; }, x, 0.0f), expected);
+}
+
+namespace {
+    // not a std::function, keeps its state
+    struct counting_sum{
+        int* calls;
+        int operator()(int a, int b) { ++*calls; return a+b; }
+    };
+}
+
+TEST(ReduceTest, functor){
+    std::vector<int> v {{1,2,3,4}};
+    int calls = 0;
+    EXPECT_EQ(func::reduce(counting_sum{&calls}, v, 0), 10);
+    EXPECT_EQ(calls, 4);
+
+    // a different result type
+    auto res = func::reduce([](double s, int a){ return s + a/2.0; }, v, 0.0);
+    EXPECT_DOUBLE_EQ(res, 5.0);
+}
+
+TEST(ReduceTest, parallel_sum){
+    std::vector<int> v(100000);
+    for (unsigned i = 0; i < v.size(); ++i) v[i] = i % 7;
+
+    long expected = 0;
+    for (auto x : v) expected += x*2;
+
+    auto x = func::transform([](int a) -> long { return a*2; }, v);
+    auto res = func::reduce(func::par, [](long a, long b) { return a+b; }, x, 0l);
+    EXPECT_EQ(res, expected);
+
+    auto res2 = func::reduce(func::par, [](long a, long b) { return a+b; }, x, 10l);
+    EXPECT_EQ(res2, expected + 10);
+}
+
+TEST(ReduceTest, parallel_min_max){
+    std::vector<float> v(12345);
+    for (unsigned i = 0; i < v.size(); ++i) v[i] = (i * 7919) % 10007;
+    v[4242] = -3.5;
+    v[777] = 20000;
+
+    auto x = func::transform([](float a) { return a; }, v);
+    auto mn = func::reduce(func::par, [](float a, float b) { return std::min(a, b); }, x, 1e9f);
+    auto mx = func::reduce(func::par, [](float a, float b) { return std::max(a, b); }, x, -1e9f);
+    EXPECT_FLOAT_EQ(mn, -3.5);
+    EXPECT_FLOAT_EQ(mx, 20000);
+}
+
+TEST(ReduceTest, parallel_small){
+    std::vector<int> e;
+    auto res = func::reduce(func::par, [](int a, int b) { return a+b; }, e, 3);
+    EXPECT_EQ(res, 3);
+
+    std::vector<int> v {{1,1,1,1,1,1}};
+    auto res2 = func::reduce(func::par, [](int a, int b) { return a+b; }, v, 0);
+    EXPECT_EQ(res2, 6);
+}
+
+TEST(ReduceTest, parallel_fallback){
+    std::list<int> l {{1,2,3,4}};
+    auto res = func::reduce(func::par, [](int a, int b) { return a*b; }, func::transform([](int a) { return a; }, l), 1);
+    EXPECT_EQ(res, 24);
+}
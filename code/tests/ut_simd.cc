@@ -0,0 +1,276 @@
+/**
+	FunctionalCpp,  A header only library for chainable functional operations
+	in C++ collections
+    Copyright (C) 2016 Luis F. Ayuso & Stefan Moosbrugger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include <vector>
+#include <list>
+#include <array>
+#include <cstdint>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <cmath>
+
+#include "simd.h"
+#include "transform.h"
+#include "filter.h"
+
+using namespace testing;
+
+TEST(Simd, pack){
+
+    using p4 = func::simd::pack<float, 4>;
+    float in[] = {1, 2, 3, 4};
+    float out[4];
+
+    auto f = [](auto x){ return (x*2 + 1) / 2 - x; };
+    f(p4::load(in)).store(out);
+    EXPECT_THAT(out, ElementsAre(.5f, .5f, .5f, .5f));
+
+    auto p = -p4::broadcast(3);
+    p += p4::load(in);
+    EXPECT_EQ(p[0], -2);
+    EXPECT_EQ(p[3], 1);
+
+    // only on packs when asked for
+    EXPECT_FALSE((func::simd::detail::lane_callable<decltype(f), float, 8>::value));
+    auto lf = func::simd::lanewise(f);
+    EXPECT_TRUE((func::simd::detail::lane_callable<decltype(lf), float, 8>::value));
+    auto typed = func::simd::lanewise([](float x){ return x+1; });
+    EXPECT_FALSE((func::simd::detail::lane_callable<decltype(typed), float, 8>::value));
+    // the scalar result is a double, the pack one would not be
+    auto widening = func::simd::lanewise([](auto x){ return x*0.5; });
+    EXPECT_FALSE((func::simd::detail::lane_callable<decltype(widening), float, 8>::value));
+}
+
+TEST(Simd, levels){
+
+    // every level up to the supported one, with tails of every length
+    auto f = func::simd::lanewise([](auto x){ return x*3 - 7; });
+    for (unsigned n : {0u, 1u, 5u, 15u, 16u, 17u, 63u, 100u}){
+        std::vector<int> in (n);
+        for (unsigned i = 0; i < n; ++i) in[i] = i;
+
+        for (auto l : {func::simd::level::scalar, func::simd::level::sse, func::simd::level::avx2, func::simd::level::avx512}){
+            std::vector<int> out (n+1, -1);
+            EXPECT_EQ(func::simd::transform_n(f, in.data(), n, out.data(), l), out.data()+n);
+            for (unsigned i = 0; i < n; ++i){
+                EXPECT_EQ(out[i], int(i)*3 - 7);
+            }
+            EXPECT_EQ(out[n], -1);
+        }
+    }
+}
+
+TEST(Simd, transform){
+
+    std::vector<float> v (1003);
+    for (unsigned i = 0; i < v.size(); ++i) v[i] = i;
+
+    auto res = func::simd_transform(func::simd::lanewise([](auto x){ return x/4 + 1; }), v);
+    ASSERT_EQ(res.size(), v.size());
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(res.data()) % 64, 0);
+    for (unsigned i = 0; i < v.size(); ++i){
+        EXPECT_EQ(res[i], v[i]/4 + 1);
+    }
+
+    // typed functors, and other collections, element by element
+    std::array<double, 3> a {{1, 2, 3}};
+    auto res2 = func::simd_transform([](double x){ return x*2; }, a);
+    EXPECT_THAT(res2, ElementsAre(2, 4, 6));
+
+    std::list<int> l {1, 2, 3};
+    auto res3 = func::simd_transform([](auto x){ return x+1; }, l);
+    EXPECT_THAT(res3, ElementsAre(2, 3, 4));
+
+    auto x = func::transform([](int x){ return x*10; }, l);
+    int out[3];
+    EXPECT_EQ(func::simd_transform([](auto x){ return x+1; }, x, out), out+3);
+    EXPECT_THAT(out, ElementsAre(11, 21, 31));
+
+    // into a given output, of a different type
+    const std::vector<float>& cv = v;
+    std::vector<int> out2 (v.size());
+    func::simd_transform(func::simd::lanewise([](auto x){ return x*2; }), cv, out2.data());
+    EXPECT_EQ(out2[1002], 2004);
+}
+
+namespace {
+    // opts in without the wrapper
+    struct affine{
+        template <typename X>
+        X operator()(const X& x) const { return x*2 + 1; }
+    };
+}
+
+namespace func{ namespace simd{
+    template <>
+    struct is_lanewise<affine> : std::true_type { };
+}}
+
+TEST(Simd, lanewise){
+
+    std::vector<float> v (1003);
+    for (unsigned i = 0; i < v.size(); ++i) v[i] = i;
+
+    // generic lambdas which do not take packs are evaluated element by element
+    auto root = func::simd_transform([](auto x){ return std::sqrt(x); }, v);
+    ASSERT_EQ(root.size(), v.size());
+    EXPECT_FLOAT_EQ(root[16], 4);
+    EXPECT_FLOAT_EQ(root[1000], std::sqrt(1000.f));
+
+    auto clamped = func::simd_transform([](auto x){ return x < 500? x: 500 - x; }, v);
+    EXPECT_EQ(clamped[10], 10);
+    EXPECT_EQ(clamped[600], -100);
+
+    auto mixed = func::simd_transform([](auto x){ return std::min(std::abs(x - 500), decltype(x)(100)); }, v);
+    EXPECT_EQ(mixed[450], 50);
+    EXPECT_EQ(mixed[0], 100);
+
+    EXPECT_TRUE((func::simd::detail::lane_callable<affine, float, 8>::value));
+    auto res = func::simd_transform(affine(), v);
+    EXPECT_EQ(res[1002], 2005);
+}
+
+TEST(Simd, mask){
+
+    using p4 = func::simd::pack<int, 4>;
+    int in[] = {1, 5, 3, 8};
+
+    auto range = func::simd::lanewise([](auto x){ return x > 2 && !(x >= 8); });
+    auto m = range(p4::load(in));
+    EXPECT_FALSE(m[0]);
+    EXPECT_TRUE(m[1]);
+    EXPECT_TRUE(m[2]);
+    EXPECT_FALSE(m[3]);
+    EXPECT_TRUE(range(5));
+    EXPECT_FALSE(range(8));
+
+    auto m2 = (p4::load(in) == 1) || (3 == p4::load(in));
+    EXPECT_THAT(std::vector<bool>({m2[0], m2[1], m2[2], m2[3]}), ElementsAre(true, false, true, false));
+    auto m3 = (p4::load(in) == 1) | (3 == p4::load(in));
+    EXPECT_THAT(std::vector<bool>({m3[0], m3[1], m3[2], m3[3]}), ElementsAre(true, false, true, false));
+
+    EXPECT_TRUE((func::simd::detail::lane_predicate<decltype(range), int, 8>::value));
+    auto generic = [](auto x){ return x > 2; };
+    EXPECT_FALSE((func::simd::detail::lane_predicate<decltype(generic), int, 8>::value));
+    auto typed = func::simd::lanewise([](int x){ return x > 2; });
+    EXPECT_FALSE((func::simd::detail::lane_predicate<decltype(typed), int, 8>::value));
+}
+
+template <typename T>
+void check_filter(){
+
+    for (unsigned n : {0u, 1u, 7u, 16u, 33u, 1000u}){
+        std::vector<T> in (n);
+        for (unsigned i = 0; i < n; ++i) in[i] = T((i*7919) % 100);
+
+        auto p = func::simd::lanewise([](auto x){ return x >= 25 && x < 75; });
+        std::vector<T> expected;
+        std::copy_if(in.begin(), in.end(), std::back_inserter(expected), p);
+
+        for (auto l : {func::simd::level::scalar, func::simd::level::sse, func::simd::level::avx2, func::simd::level::avx512}){
+            std::vector<T> out (n);
+            T* end = func::simd::filter_n(p, in.data(), n, out.data(), l);
+            out.resize(end - out.data());
+            EXPECT_EQ(out, expected);
+        }
+    }
+}
+
+TEST(Simd, filter_levels){
+    check_filter<int>();
+    check_filter<float>();
+    check_filter<double>();
+    check_filter<std::int64_t>();
+    check_filter<std::int16_t>();
+    check_filter<std::uint8_t>();
+}
+
+TEST(Simd, filter){
+
+    std::vector<float> v (1003);
+    for (unsigned i = 0; i < v.size(); ++i) v[i] = i % 10;
+
+    auto res = func::simd_filter(func::simd::lanewise([](auto x){ return x < 5; }), v);
+    EXPECT_EQ(res.size(), 503);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(res.data()) % 64, 0);
+    EXPECT_TRUE(std::all_of(res.begin(), res.end(), [](float x){ return x < 5; }));
+
+    // the compacted block feeds the next stage
+    auto sum = func::simd_transform(func::simd::lanewise([](auto x){ return x*2; }), res);
+    EXPECT_EQ(std::accumulate(sum.begin(), sum.end(), 0.f), 2*(0+1+2+3+4)*100 + 2*(0+1+2));
+
+    // typed predicates, and other collections
+    std::list<int> l {1, 6, 2, 7};
+    auto res2 = func::simd_filter([](int x){ return x > 5; }, l);
+    EXPECT_THAT(res2, ElementsAre(6, 7));
+
+    int out[4];
+    const std::vector<int> cv {1, 6, 2, 7};
+    EXPECT_EQ(func::simd_filter([](int x){ return x < 5; }, cv, out), out+2);
+    EXPECT_THAT(std::vector<int>(out, out+2), ElementsAre(1, 2));
+
+    // generic predicates which are not lanewise, on contiguous sources, element by element
+    auto range = func::simd_filter([](auto x){ return x > 0 && x < 5; }, v);
+    EXPECT_EQ(range.size(), 402);
+    EXPECT_TRUE(std::all_of(range.begin(), range.end(), [](float x){ return x > 0 && x < 5; }));
+    EXPECT_EQ(func::simd_filter(func::simd::lanewise([](auto x){ return x > 0 && x < 5; }), v), range);
+
+    auto odd = func::simd_filter([](auto x){ return std::fmod(x, 2) == 1? true: false; }, v);
+    EXPECT_EQ(odd.size(), 501);
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+class BenchmarkSimdFilterTest : public ::testing::Test {
+protected:
+    const unsigned BenchmarkSize = 1024 * 1024;
+
+    std::vector<float> input;
+    std::vector<float> res;
+
+    virtual void SetUp() {
+
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<int> dist(0, 999);
+
+        input.resize(BenchmarkSize);
+        for (unsigned i = 0; i < BenchmarkSize; ++i){
+            input[i] = dist(gen);
+        }
+        res.resize(BenchmarkSize);
+    }
+};
+
+TEST_F(BenchmarkSimdFilterTest, filter){
+
+    // about half of the elements
+    auto x = func::filter([](float x){ return x < 500; }, input);
+
+    std::vector<float> out (x.begin(), x.end());
+    EXPECT_GT(out.size(), 0);
+}
+
+TEST_F(BenchmarkSimdFilterTest, simd_filter){
+
+    float* end = func::simd_filter(func::simd::lanewise([](auto x){ return x < 500; }), input, res.data());
+    EXPECT_GT(end - res.data(), 0);
+}
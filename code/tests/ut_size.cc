@@ -0,0 +1,165 @@
+/**
+	FunctionalCpp,  A header only library for chainable functional operations
+	in C++ collections
+    Copyright (C) 2016 Luis F. Ayuso & Stefan Moosbrugger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "gtest/gtest.h"
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include <vector>
+#include <list>
+#include <set>
+#include <forward_list>
+#include <string>
+
+#include "transform.h"
+#include "filter.h"
+#include "mux.h"
+#include "demux.h"
+#include "zip.h"
+#include "generator.h"
+#include "parallel.h"
+
+using namespace testing;
+
+namespace {
+
+    template <typename C, typename = void>
+    struct sized : std::false_type { };
+
+    template <typename C>
+    struct sized<C, decltype(void(std::declval<C&>().size()))> : std::true_type { };
+
+    // counts the allocations made through it
+    template <typename T>
+    struct counting_allocator{
+        using value_type = T;
+        static int allocations;
+
+        counting_allocator() = default;
+        template <typename U> counting_allocator(const counting_allocator<U>&) {}
+
+        T* allocate(std::size_t n){
+            ++allocations;
+            return std::allocator<T>().allocate(n);
+        }
+        void deallocate(T* p, std::size_t n){
+            std::allocator<T>().deallocate(p, n);
+        }
+        bool operator==(const counting_allocator&) const { return true; }
+        bool operator!=(const counting_allocator&) const { return false; }
+    };
+
+    template <typename T>
+    int counting_allocator<T>::allocations = 0;
+}
+
+TEST(Size, exact){
+
+    std::vector<int> v(10);
+    std::list<int> l(7);
+
+    auto a = func::transform([](int x) { return x+1; }, v);
+    auto b = func::transform([](int x) { return x+1; }, func::transform([](int x) { return x+1; }, l));
+    auto c = func::zip(v, l);
+    auto d = func::transform([](int x) { return x*2; }, func::sequence(0, 1, 42));
+
+    EXPECT_EQ(a.size(), 10);
+    EXPECT_EQ(b.size(), 7);
+    EXPECT_EQ(c.size(), 7);
+    EXPECT_EQ(d.size(), 42);
+}
+
+TEST(Size, hint){
+
+    std::vector<int> v(10);
+
+    auto a = func::filter([](int x) { return x > 0; }, v);
+    auto b = func::transform([](int x) { return x+1; }, func::filter([](int x) { return x > 0; }, v));
+    auto c = func::mux([](auto& it, const auto&) { return *it++; }, v);
+    auto d = func::demux([](int x) { return std::vector<int>(x, x); }, v);
+    std::forward_list<int> fl(3);
+    auto e = func::transform([](int x) { return x; }, fl);
+
+    EXPECT_FALSE(sized<decltype(a)>::value);
+    EXPECT_FALSE(sized<decltype(b)>::value);
+    EXPECT_FALSE(sized<decltype(c)>::value);
+    EXPECT_FALSE(sized<decltype(d)>::value);
+    EXPECT_FALSE(sized<decltype(e)>::value);
+    auto f = func::transform([](int x) { return x; }, v);
+    EXPECT_TRUE(sized<decltype(f)>::value);
+
+    EXPECT_EQ(a.size_hint(), 10);
+    EXPECT_EQ(b.size_hint(), 10);
+    EXPECT_EQ(c.size_hint(), 10);
+    EXPECT_EQ(d.size_hint(), 0);
+    EXPECT_EQ(e.size_hint(), 0);
+    EXPECT_EQ(func::zip(a, v).size_hint(), 10);
+}
+
+TEST(Size, collect_reserves){
+
+    using alloc = counting_allocator<int>;
+    using vec = std::vector<int, alloc>;
+
+    std::vector<int> v(100000);
+    for (unsigned i = 0; i < v.size(); ++i) v[i] = i;
+
+    alloc::allocations = 0;
+    auto res = func::collect<vec>(func::transform([](int x) { return x+1; }, v));
+    EXPECT_EQ(alloc::allocations, 1);
+    ASSERT_EQ(res.size(), v.size());
+    EXPECT_EQ(res.back(), 100000);
+
+    // reserved for the upper bound
+    alloc::allocations = 0;
+    auto odd = func::collect<vec>(func::filter([](int x) { return x%2; }, v));
+    EXPECT_EQ(alloc::allocations, 1);
+    EXPECT_EQ(odd.size(), 50000);
+}
+
+TEST(Size, collect_containers){
+
+    std::vector<int> v {3,1,2,3,1};
+
+    auto s = func::collect<std::set<int>>(func::transform([](int x) { return x*2; }, v));
+    EXPECT_THAT(s, ElementsAre(2,4,6));
+
+    auto l = func::collect<std::list<int>>(func::transform(func::par, [](int x) { return x*2; }, v));
+    EXPECT_THAT(l, ElementsAre(6,2,4,6,2));
+
+    std::vector<int> d = func::collect(func::demux([](int x) { return std::vector<int>(x, x); }, v));
+    EXPECT_EQ(d.size(), 10);
+}
+
+TEST(Size, unbounded){
+
+    std::vector<int> v {10,20,30};
+
+    // an unbounded sequence has no length to reserve for, the other inputs bound the zip
+    EXPECT_EQ(func::sequence(0, 1).size_hint(), 0);
+    EXPECT_EQ(func::sequence(0, 1, 5).size_hint(), 5);
+    EXPECT_EQ(func::transform([](int x) { return x; }, func::sequence(0, 1)).size_hint(), 0);
+    EXPECT_EQ(func::zip(func::sequence(0, 1), v).size_hint(), 3);
+    EXPECT_EQ(func::zip(func::demux([](int x) { return std::vector<int>(x, x); }, v), v).size_hint(), 3);
+
+    auto res = func::collect(func::zip(func::sequence(0, 1), v));
+    EXPECT_THAT(res, ElementsAre(std::make_pair(0,10), std::make_pair(1,20), std::make_pair(2,30)));
+
+    auto res2 = func::collect(func::zip(v, func::sequence(0, 1)));
+    EXPECT_THAT(res2, ElementsAre(std::make_pair(10,0), std::make_pair(20,1), std::make_pair(30,2)));
+}
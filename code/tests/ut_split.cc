@@ -0,0 +1,120 @@
+/**
+	FunctionalCpp,  A header only library for chainable functional operations
+	in C++ collections
+    Copyright (C) 2016 Luis F. Ayuso & Stefan Moosbrugger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "gtest/gtest.h"
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include <vector>
+#include <string>
+#include <random>
+
+#include "mux.h"
+#include "split.h"
+
+using namespace testing;
+
+namespace {
+
+    std::vector<std::string> mux_split(std::string& text, char delim){
+        using it_t = std::string::iterator;
+        auto x = func::mux([delim](it_t& it, const it_t& end) -> std::string {
+            std::string ret;
+            while (it != end && *it != delim) {
+                ret += *it;
+                ++it;
+            }
+            if (it != end) ++it;
+            return ret;
+        }, text);
+        return std::vector<std::string>(x.begin(), x.end());
+    }
+}
+
+TEST(Split, small){
+
+    std::string cad (" hello\n new line \n adios.");
+    auto res = func::parallel_split(cad, '\n');
+    EXPECT_THAT(res, ElementsAre(" hello", " new line ", " adios."));
+
+    EXPECT_TRUE(func::parallel_split(std::string(), '\n').empty());
+    EXPECT_THAT(func::parallel_split(std::string("a\n"), '\n'), ElementsAre("a"));
+    EXPECT_THAT(func::parallel_split(std::string("\n\na"), '\n'), ElementsAre("", "", "a"));
+}
+
+TEST(Split, same_as_mux){
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> len(0, 120);
+
+    for (int round = 0; round < 20; ++round){
+        std::string text;
+        int lines = 1 + round * 50;
+        for (int i = 0; i < lines; ++i){
+            text += std::string(len(gen), 'a' + i%26);
+            if (i+1 < lines || round%2) text += '\n';
+        }
+
+        auto expected = mux_split(text, '\n');
+        auto res = func::parallel_split(text, '\n');
+        ASSERT_EQ(res, expected) << "round " << round;
+    }
+}
+
+TEST(Split, long_record){
+
+    // a single record spans over all the ranges
+    std::string text (10000, 'x');
+    text = "a\n" + text + "\nb";
+    auto res = func::parallel_split(text, '\n');
+    ASSERT_EQ(res.size(), 3);
+    EXPECT_EQ(res[0], "a");
+    EXPECT_EQ(res[1].size(), 10000);
+    EXPECT_EQ(res[2], "b");
+}
+
+TEST(Split, other_buffers){
+
+    std::vector<int> v;
+    for (int i = 0; i < 1000; ++i) v.push_back(i%10);
+
+    auto res = func::parallel_split<std::vector<int>>(v, 0);
+    ASSERT_EQ(res.size(), 101);
+    EXPECT_TRUE(res[0].empty());
+    EXPECT_THAT(res[1], ElementsAre(1,2,3,4,5,6,7,8,9));
+    EXPECT_THAT(res[100], ElementsAre(1,2,3,4,5,6,7,8,9));
+}
+
+class BenchmarkSplitTest : public ::testing::Test {
+protected:
+    std::string text;
+
+    virtual void SetUp() {
+        for (int i = 0; i < 200000; ++i) text += "record number " + std::to_string(i) + " with some payload\n";
+    }
+};
+
+TEST_F(BenchmarkSplitTest, Mux) {
+    auto res = mux_split(text, '\n');
+    EXPECT_EQ(res.size(), 200000);
+}
+
+TEST_F(BenchmarkSplitTest, Parallel) {
+    auto res = func::parallel_split(text, '\n');
+    EXPECT_EQ(res.size(), 200000);
+}
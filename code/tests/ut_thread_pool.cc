@@ -0,0 +1,143 @@
+/**
+	FunctionalCpp,  A header only library for chainable functional operations
+	in C++ collections
+    Copyright (C) 2016 Luis F. Ayuso & Stefan Moosbrugger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <set>
+#include <mutex>
+#include <stdexcept>
+
+#include "thread_pool.h"
+
+using namespace testing;
+
+TEST(ThreadPool, size){
+
+    func::exec::thread_pool pool(3);
+    EXPECT_EQ(pool.size(), 3);
+    EXPECT_EQ(pool.concurrency(), 4);
+
+    EXPECT_GE(func::exec::thread_pool::instance().size(), 1);
+}
+
+TEST(ThreadPool, task_group){
+
+    func::exec::thread_pool pool(4);
+    std::atomic<int> count(0);
+
+    func::exec::task_group group(pool);
+    for (int i = 0; i < 1000; ++i){
+        group.run([&]() { ++count; });
+    }
+    group.wait();
+    EXPECT_EQ(count, 1000);
+}
+
+TEST(ThreadPool, workers_are_used){
+
+    func::exec::thread_pool pool(4);
+
+    std::mutex lock;
+    std::set<std::thread::id> ids;
+
+    func::exec::task_group group(pool);
+    for (int i = 0; i < 64; ++i){
+        group.run([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            std::lock_guard<std::mutex> guard(lock);
+            ids.insert(std::this_thread::get_id());
+        });
+    }
+    group.wait();
+    EXPECT_GT(ids.size(), 1);
+}
+
+TEST(ThreadPool, exception){
+
+    func::exec::thread_pool pool(2);
+    std::atomic<int> count(0);
+
+    func::exec::task_group group(pool);
+    for (int i = 0; i < 10; ++i){
+        group.run([&, i]() {
+            ++count;
+            if (i == 5) throw std::runtime_error("task failed");
+        });
+    }
+    EXPECT_THROW(group.wait(), std::runtime_error);
+    EXPECT_EQ(count, 10);
+}
+
+TEST(ThreadPool, parallel_for){
+
+    func::exec::thread_pool pool(4);
+
+    std::vector<int> v(100003, 0);
+    auto body = [&](std::size_t from, std::size_t to){
+        for (std::size_t i = from; i < to; ++i) v[i] += i;
+    };
+    func::exec::parallel_for(pool, v.size(), body, 64);
+
+    for (std::size_t i = 0; i < v.size(); ++i){
+        ASSERT_EQ(v[i], i);
+    }
+}
+
+TEST(ThreadPool, chunks_aligned){
+
+    func::exec::thread_pool pool(4);
+
+    std::mutex lock;
+    std::vector<std::pair<std::size_t,std::size_t>> chunks;
+    auto body = [&](std::size_t from, std::size_t to){
+        std::lock_guard<std::mutex> guard(lock);
+        chunks.emplace_back(from, to);
+    };
+    func::exec::parallel_for(pool, 1000, body, 64);
+
+    std::sort(chunks.begin(), chunks.end());
+    ASSERT_GT(chunks.size(), 1);
+    EXPECT_EQ(chunks.front().first, 0);
+    EXPECT_EQ(chunks.back().second, 1000);
+    for (std::size_t i = 1; i < chunks.size(); ++i){
+        EXPECT_EQ(chunks[i-1].second, chunks[i].first);
+        EXPECT_EQ(chunks[i].first % 64, 0);
+    }
+}
+
+TEST(ThreadPool, nested){
+
+    func::exec::thread_pool pool(2);
+
+    std::atomic<int> count(0);
+    auto inner = [&](std::size_t from, std::size_t to){
+        count += to - from;
+    };
+    auto outer = [&](std::size_t from, std::size_t to){
+        for (std::size_t i = from; i < to; ++i){
+            func::exec::parallel_for(pool, 100, inner);
+        }
+    };
+    func::exec::parallel_for(pool, 16, outer);
+    EXPECT_EQ(count, 1600);
+}
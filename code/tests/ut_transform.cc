@@ -29,6 +29,8 @@
 #include <random>
 
 #include "transform.h"
+#include "reduce.h"
+#include "simd.h"
 
 using namespace testing;
 
@@ -236,6 +238,47 @@ TEST(Transform, chain){
 }
 
 
+TEST(Transform, fusion){
+        // nested transforms iterate the innermost collection with the composed functors
+        std::vector<int> v = { 0,1,2,3 };
+        int calls = 0;
+
+        auto x = func::transform([](int a) { return a*10; },
+                 func::transform([](int a) -> float { return a+0.5f; },
+                 func::transform([&calls](int a) { ++calls; return a+1; }, v)));
+
+        using iter = decltype(x.begin());
+        static_assert(std::is_same<iter::source_type, std::vector<int>::iterator>(), "fused with the source");
+        static_assert(std::is_same<std::iterator_traits<iter>::iterator_category, std::random_access_iterator_tag>(), "");
+
+        std::vector<float> res (x.begin(), x.end());
+        EXPECT_THAT(res, ElementsAre(10,20,30,40));
+        EXPECT_EQ(calls, 4);
+        EXPECT_EQ(x.begin()[2], 30);
+        EXPECT_EQ(x.size(), 4);
+
+        // the nested chains are still there
+        std::vector<float> inner (x.store->begin(), x.store->end());
+        EXPECT_THAT(inner, ElementsAre(1.5,2.5,3.5,4.5));
+}
+
+TEST(Transform, fusion_state){
+        // stateful functors keep their state in the chain
+        std::list<int> l = { 1,2,3 };
+        struct Counter{
+            int n = 0;
+            int operator()(int a){ return a + n++; }
+        };
+
+        auto x = func::transform(Counter(),
+                 func::transform(Counter(), l));
+
+        std::vector<int> res (x.begin(), x.end());
+        EXPECT_THAT(res, ElementsAre(1,4,7));
+        EXPECT_EQ(x.func.n, 3);
+        EXPECT_EQ(x.store->func.n, 3);
+}
+
 class BenchmarkVectorTest : public ::testing::Test {
 protected:
     const unsigned BenchmarkSize = 1024 * 1024;
@@ -300,6 +343,40 @@ TEST_F(BenchmarkVectorTest, pre_func){
     }
 }
 
+TEST_F(BenchmarkVectorTest, simd){
+
+    // generic functor, evaluated on packs of lanes
+    auto f = func::simd::lanewise([](auto a){ return ((a+1)*3)/4 - 1; });
+
+    func::simd_transform(f, input, res.data());
+    EXPECT_EQ(res[BenchmarkSize-1], f(input[BenchmarkSize-1]));
+}
+
+TEST_F(BenchmarkVectorTest, reduce_base){
+
+    auto a = [](float a){ return a-1; };
+    auto b = [](float a){ return a/4; };
+    auto c = [](float a){ return a*3; };
+    auto d = [](float a){ return a+1; };
+
+    float sum = 0;
+    for (unsigned i = 0; i < BenchmarkSize; ++i){
+        sum += a(b(c(d(input[i]))));
+    }
+    EXPECT_GT(sum, 0);
+}
+
+TEST_F(BenchmarkVectorTest, reduce_func){
+
+    auto x = func::transform([](float a){ return a-1; },
+             func::transform([](float a){ return a/4; },
+             func::transform([](float a){ return a*3; },
+             func::transform([](float a){ return a+1; }, input))));
+
+    float sum = func::reduce([](float s, float v){ return s+v; }, x, 0.0f);
+    EXPECT_GT(sum, 0);
+}
+
 TEST_F(BenchmarkVectorTest, Bad){
 
     auto a = [](int a){ return a-1; };
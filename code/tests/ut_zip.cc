@@ -25,10 +25,14 @@
 #include <map>
 #include <list>
 #include <array>
+#include <string>
 
 #include <random>
 
 #include "zip.h"
+#include "filter.h"
+#include "mux.h"
+#include "generator.h"
 
 using namespace testing;
 
@@ -268,3 +272,173 @@ TEST(Zip, zip_methods_same_size){
     EXPECT_EQ((x.end()-x.begin()),4);
 }
 
+
+TEST(Zip, self_terminating){
+
+    std::vector<int> v {1,2,3,4,5,6,7,8};
+    std::list<int> l {10,20,30,40,50};
+
+    auto even = func::filter([](int x) { return x%2 == 0; }, v);
+    auto odd = func::filter([](int x) { return x%2 == 1; }, l);
+
+    using filter_it = decltype(even.begin());
+    EXPECT_TRUE(func::detail::self_terminating<filter_it>::value);
+    EXPECT_FALSE(func::detail::self_terminating<std::vector<int>::iterator>::value);
+
+    // filters know their end, the zip does not keep a copy
+    auto x = func::zip(even, func::filter([](int x) { return x > 2; }, v));
+    using zip_it = decltype(x.begin());
+    EXPECT_TRUE((std::is_same<zip_it::end_type, std::pair<func::detail::no_end, func::detail::no_end>>::value));
+    EXPECT_LT(sizeof(zip_it), 3*sizeof(filter_it));
+
+    std::vector<std::pair<int,int>> res (x.begin(), x.end());
+    EXPECT_THAT(res, ElementsAre(std::make_pair(2,3), std::make_pair(4,4), std::make_pair(6,5), std::make_pair(8,6)));
+
+    // mixed, the shortest one stops the zip
+    auto y = func::zip(l, even, func::sequence(0, 1, 3));
+    std::vector<std::tuple<int,int,int>> res2 (y.begin(), y.end());
+    EXPECT_EQ(res2.size(), 3);
+    EXPECT_TRUE(y.begin() != y.end());
+    EXPECT_FALSE(y.end() != y.end());
+
+    auto z = func::zip(odd, v);
+    EXPECT_EQ(z.begin(), z.end());
+    EXPECT_TRUE(z.begin().at_end());
+}
+
+TEST(Zip, references){
+
+    std::vector<std::string> names {"one", "two", "three"};
+    std::vector<int> v {1, 2, 3};
+
+    auto x = func::zip_ref(names, v);
+    using value_type = decltype(x)::value_type;
+    EXPECT_TRUE((std::is_same<value_type, std::pair<std::string&, int&>>::value));
+
+    // elements alias the inputs, writes go through
+    for (auto p : x){
+        p.first += "!";
+        p.second *= 10;
+    }
+    EXPECT_THAT(names, ElementsAre("one!", "two!", "three!"));
+    EXPECT_THAT(v, ElementsAre(10, 20, 30));
+    EXPECT_EQ(&(*x.begin()).first, &names[0]);
+    EXPECT_EQ(&(*(x.begin()+2)).second, &v[2]);
+    EXPECT_EQ(&x.begin()[1].first, &names[1]);
+
+    // chains produce temporaries, those are kept by value
+    const std::vector<int>& cv = v;
+    auto y = func::zip_ref(cv, func::transform([](int a) { return a+1; }, v), names);
+    using value_type2 = decltype(y)::value_type;
+    EXPECT_TRUE((std::is_same<value_type2, std::tuple<const int&, int, std::string&>>::value));
+
+    std::vector<int> res;
+    for (auto t : y){
+        res.push_back(std::get<0>(t) + std::get<1>(t));
+    }
+    EXPECT_THAT(res, ElementsAre(21, 41, 61));
+}
+
+TEST(Zip, counted){
+
+    std::vector<int> a {1,2,3,4,5,6};
+    std::vector<int> b {10,20,30,40};
+    std::vector<float> c {.1f,.2f,.3f,.4f,.5f};
+    std::list<int> l {7,8,9};
+
+    // random access inputs, the length is computed once
+    auto x = func::zip(a, b, func::transform([](float f) { return f*10; }, c), func::sequence(0, 2, 5));
+    using counted_it = decltype(x.begin());
+    EXPECT_TRUE(counted_it::counted::value);
+    EXPECT_EQ(x.begin().remaining(), 4);
+    EXPECT_EQ(x.end() - x.begin(), 4);
+
+    std::vector<std::tuple<int,int,float,int>> res (x.begin(), x.end());
+    ASSERT_EQ(res.size(), 4);
+    EXPECT_EQ(res[3], (std::tuple<int,int,float,int>(4, 40, 4.f, 6)));
+
+    auto it = x.begin() + 3;
+    EXPECT_FALSE(it.at_end());
+    EXPECT_EQ(++it, x.end());
+    EXPECT_EQ(--it, x.begin() + 3);
+    EXPECT_EQ(std::get<0>(*it), 4);
+
+    // nested zips provide their own counter
+    auto y = func::zip(func::zip(a, b), func::sequence(0, 1, 10));
+    EXPECT_TRUE(decltype(y.begin())::counted::value);
+    EXPECT_EQ(y.end() - y.begin(), 4);
+    EXPECT_EQ(std::distance(y.begin(), y.end()), 4);
+
+    // the rest check every input
+    auto z = func::zip(a, l);
+    EXPECT_FALSE(decltype(z.begin())::counted::value);
+    std::vector<std::pair<int,int>> res2 (z.begin(), z.end());
+    EXPECT_THAT(res2, ElementsAre(std::make_pair(1,7), std::make_pair(2,8), std::make_pair(3,9)));
+}
+
+TEST(Zip, unbounded_sequence){
+
+    std::vector<int> v {10,20,30};
+
+    // the other input bounds the length, no matter the order
+    auto x = func::zip(func::sequence(0, 1), v);
+    EXPECT_EQ(x.end() - x.begin(), 3);
+    std::vector<std::pair<int,int>> res (x.begin(), x.end());
+    EXPECT_THAT(res, ElementsAre(std::make_pair(0,10), std::make_pair(1,20), std::make_pair(2,30)));
+
+    auto y = func::zip(v, func::sequence(0, 1));
+    EXPECT_EQ(y.end() - y.begin(), 3);
+    std::vector<std::pair<int,int>> res2 (y.begin(), y.end());
+    EXPECT_THAT(res2, ElementsAre(std::make_pair(10,0), std::make_pair(20,1), std::make_pair(30,2)));
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+class BenchmarkZipTest : public ::testing::Test {
+protected:
+    const unsigned BenchmarkSize = 64 * 1024;
+
+    struct record{
+        char payload[1020];
+        int key;
+    };
+
+    std::vector<record> left;
+    std::vector<record> right;
+
+    virtual void SetUp() {
+
+        std::random_device rd;
+        std::uniform_int_distribution<int> dist(0, 999);
+
+        left.resize(BenchmarkSize);
+        right.resize(BenchmarkSize);
+
+        for (unsigned i = 0; i < BenchmarkSize; ++i){
+            left[i].key = dist(rd);
+            right[i].key = dist(rd);
+        }
+    }
+};
+
+TEST_F(BenchmarkZipTest, zip){
+
+    auto x = func::zip(left, right);
+
+    long sum = 0;
+    for (auto p : x){
+        sum += p.first.key * p.second.key;
+    }
+    EXPECT_GE(sum, 0);
+}
+
+TEST_F(BenchmarkZipTest, zip_ref){
+
+    auto x = func::zip_ref(left, right);
+
+    long sum = 0;
+    for (auto p : x){
+        sum += p.first.key * p.second.key;
+    }
+    EXPECT_GE(sum, 0);
+}